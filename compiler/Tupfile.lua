@@ -1,8 +1,8 @@
 local Compiler = Define.Executable
 {
 	Name = 'kk',
-	Sources = Item 'main.cxx' + 'core.cxx',
+	Sources = Item 'main.cxx' + 'core.cxx' + 'serial.cxx' + 'loader.cxx' + 'incremental.cxx',
 	BuildFlags = ' -I/usr/include/llvm-3.4 -I/usr/include/llvm-c-3.4',
-	LinkFlags = ' -lLLVM-3.4'
+	LinkFlags = ' -lLLVM-3.4 -lyajl'
 	--LinkFlags = ' -ljson-c'
 }
@@ -5,69 +5,620 @@ namespace Core
 
 constexpr TypeIDT DefaultTypeID = 0;
 
-PositionBaseT::~PositionBaseT(void) {}
+//================================================================================================================
+// Memory
+static thread_local ArenaT *CurrentArena = nullptr;
+static thread_local ArenaT *ReleasingArena = nullptr;
+static thread_local size_t AllocatedBytes = 0; // For evaluation budgets
 
-HardPositionT::HardPositionT(char const *File, char const *Function, int Line) : Position(::StringT() << "(HARD)" << File << "/" << Function << ":" << Line) {}
+constexpr size_t ArenaT::Alignment;
+constexpr size_t ArenaT::MaxPooled;
 
-std::string HardPositionT::AsString(void) const { return Position; }
+ArenaT::ArenaT(size_t BlockSize) : BlockSize(BlockSize), IsReleasing(false), Next(nullptr), End(nullptr), Live(nullptr), PooledBytes(0)
+{
+	Assert(BlockSize >= MaxPooled);
+	FreeLists.fill(nullptr);
+}
+
+ArenaT::~ArenaT(void) 
+{ 
+	Assert(CurrentArena != this);
+	Release(); 
+}
+
+void *ArenaT::Allocate(size_t Size)
+{
+	Size = (std::max(Size, size_t(1)) + Alignment - 1) & ~(Alignment - 1);
+	if (Size <= MaxPooled)
+	{
+		auto &FreeList = FreeLists[Size / Alignment - 1];
+		if (FreeList)
+		{
+			auto Out = FreeList;
+			FreeList = *static_cast<void **>(Out);
+			return Out;
+		}
+	}
+	else if (Size > BlockSize / 4)
+	{
+		// Large allocations get their own block so they don't waste the tail of the current one
+		Blocks.emplace_back(new char[Size]);
+		return Blocks.back().get();
+	}
+	if (static_cast<size_t>(End - Next) < Size)
+	{
+		Blocks.emplace_back(new char[BlockSize]);
+		Next = Blocks.back().get();
+		End = Next + BlockSize;
+	}
+	auto Out = Next;
+	Next += Size;
+	return Out;
+}
+
+void ArenaT::Free(void *Memory, size_t Size)
+{
+	if (IsReleasing) return;
+	Size = (std::max(Size, size_t(1)) + Alignment - 1) & ~(Alignment - 1);
+	if (Size > MaxPooled) return; // Reclaimed on release
+	PooledBytes += Size;
+	auto &FreeList = FreeLists[Size / Alignment - 1];
+	*static_cast<void **>(Memory) = FreeList;
+	FreeList = Memory;
+}
+
+void ArenaT::Release(void)
+{
+	Assert(!ReleasingArena);
+	IsReleasing = true;
+	ReleasingArena = this;
+	// Atoms stop counting references to this arena's nuclei while releasing, so destroying one never touches (or 
+	// destroys) another.  References out of the arena are still dropped normally.  Referrers outside the arena, like 
+	// a module's atom on the stack, are cleared first so they don't dangle.
+	for (auto Nucleus = Live; Nucleus; Nucleus = Nucleus->LiveNext)
+	{
+		for (auto Atom = Nucleus->Atoms; Atom; )
+		{
+			auto Next = Atom->Next;
+			Atom->Nucleus = nullptr;
+			Atom->Previous = Atom->Next = nullptr;
+			Atom = Next;
+		}
+		Nucleus->Atoms = nullptr;
+	}
+	for (auto Nucleus = Live; Nucleus; )
+	{
+		auto Next = Nucleus->LiveNext;
+		Nucleus->~NucleusT();
+		Nucleus = Next;
+	}
+	Live = nullptr;
+	Blocks.clear();
+	Next = End = nullptr;
+	FreeLists.fill(nullptr);
+	IsReleasing = false;
+	ReleasingArena = nullptr;
+}
+
+ArenaT::CollectStatsT::CollectStatsT(void) : Scanned(0), Freed(0), FreedBytes(0) {}
+
+auto ArenaT::CollectStatsT::operator +=(CollectStatsT const &Other) -> CollectStatsT &
+{
+	Scanned += Other.Scanned;
+	Freed += Other.Freed;
+	FreedBytes += Other.FreedBytes;
+	return *this;
+}
+
+/*
+Trial deletion: each nucleus starts with its number of referring atoms, less the ones held by nuclei in this arena.  
+Anything with referrers left over is held from outside, and is kept along with whatever it reaches.
+*/
+auto ArenaT::Collect(void) -> CollectStatsT
+{
+	Assert(!IsReleasing);
+	CollectStatsT Stats;
+	
+	struct CandidateT
+	{
+		size_t References;
+		bool Reachable;
+	};
+	std::unordered_map<NucleusT *, CandidateT> Candidates;
+	for (auto Nucleus = Live; Nucleus; Nucleus = Nucleus->LiveNext)
+	{
+		CandidateT Candidate{0, false};
+		for (auto Atom = Nucleus->Atoms; Atom; Atom = Atom->Next) ++Candidate.References;
+		Candidates.emplace(Nucleus, Candidate);
+	}
+	Stats.Scanned = Candidates.size();
+	
+	for (auto &Candidate : Candidates)
+		Candidate.first->Trace([&Candidates](AtomT &Atom)
+		{
+			if (!Atom.Nucleus) return;
+			auto Found = Candidates.find(Atom.Nucleus);
+			if (Found != Candidates.end()) --Found->second.References;
+		});
+	
+	std::vector<NucleusT *> Pending;
+	for (auto &Candidate : Candidates)
+	{
+		if (!Candidate.second.References) continue;
+		Candidate.second.Reachable = true;
+		Pending.push_back(Candidate.first);
+	}
+	auto const Reach = [&Candidates, &Pending](AtomT &Atom)
+	{
+		if (!Atom.Nucleus) return;
+		auto Found = Candidates.find(Atom.Nucleus);
+		if ((Found == Candidates.end()) || Found->second.Reachable) return;
+		Found->second.Reachable = true;
+		Pending.push_back(Atom.Nucleus);
+	};
+	while (!Pending.empty())
+	{
+		auto Nucleus = Pending.back();
+		Pending.pop_back();
+		Nucleus->Trace(Reach);
+	}
+	
+	std::vector<NucleusT *> Garbage;
+	for (auto &Candidate : Candidates)
+		if (!Candidate.second.Reachable) Garbage.push_back(Candidate.first);
+	Candidates.clear();
+	
+	// Cut every reference out of the garbage first, so destroying one piece never reaches into another
+	for (auto Nucleus : Garbage)
+		Nucleus->Trace([](AtomT &Atom) { if (Atom.Nucleus) Atom.Detach(); });
+	auto const PooledBefore = PooledBytes;
+	for (auto Nucleus : Garbage)
+	{
+		Assert(!Nucleus->Atoms);
+		delete Nucleus;
+	}
+	Stats.Freed = Garbage.size();
+	Stats.FreedBytes = PooledBytes - PooledBefore;
+	
+	Totals += Stats;
+	return Stats;
+}
+
+auto ArenaT::CollectTotals(void) const -> CollectStatsT const & { return Totals; }
+
+size_t ArenaT::Pooled(void) const { return PooledBytes; }
+
+ArenaT *ArenaT::Current(void) { return CurrentArena; }
+
+ArenaT::ScopeT::ScopeT(ArenaT &Arena) : Previous(CurrentArena) { CurrentArena = &Arena; }
+
+ArenaT::ScopeT::~ScopeT(void) { CurrentArena = Previous; }
+
+//================================================================================================================
+// Positions
+namespace
+{
+struct PositionEntryT
+{
+	enum struct OriginT : uint8_t { Invalid, Hard, Loaded } Origin;
+	uint32_t Line;
+	char const *File;
+	union
+	{
+		char const *Function; // Hard
+		size_t Offset; // Loaded
+	};
+};
+
+struct PositionTableT
+{
+	std::mutex Mutex;
+	std::deque<PositionEntryT> Entries;
+	std::deque<std::string> Files;
+	std::map<std::string, char const *> FileLookup;
+	
+	PositionTableT(void) 
+	{ 
+		PositionEntryT Invalid;
+		Invalid.Origin = PositionEntryT::OriginT::Invalid;
+		Invalid.Line = 0;
+		Invalid.File = "invalid";
+		Invalid.Function = "";
+		Entries.push_back(Invalid);
+	}
+	
+	PositionT Add(PositionEntryT const &Entry)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		AssertLT(Entries.size(), std::numeric_limits<uint32_t>::max());
+		PositionT Out;
+		Out.ID = static_cast<uint32_t>(Entries.size());
+		Entries.push_back(Entry);
+		return Out;
+	}
+};
+
+PositionTableT &GetPositionTable(void)
+{
+	static PositionTableT Table;
+	return Table;
+}
+}
+
+PositionT::PositionT(void) : ID(0) {}
+
+PositionT PositionT::Hard(char const *File, char const *Function, int Line)
+{
+	PositionEntryT Entry;
+	Entry.Origin = PositionEntryT::OriginT::Hard;
+	Entry.Line = Line;
+	Entry.File = File;
+	Entry.Function = Function;
+	return GetPositionTable().Add(Entry);
+}
+
+PositionT PositionT::Loaded(char const *File, size_t Offset)
+{
+	PositionEntryT Entry;
+	Entry.Origin = PositionEntryT::OriginT::Loaded;
+	Entry.Line = 0;
+	Entry.File = File;
+	Entry.Offset = Offset;
+	return GetPositionTable().Add(Entry);
+}
+
+char const *PositionT::InternFile(std::string const &File)
+{
+	auto &Table = GetPositionTable();
+	std::lock_guard<std::mutex> Lock(Table.Mutex);
+	auto Found = Table.FileLookup.find(File);
+	if (Found != Table.FileLookup.end()) return Found->second;
+	Table.Files.push_back(File);
+	auto Out = Table.Files.back().c_str();
+	Table.FileLookup.emplace(File, Out);
+	return Out;
+}
+
+std::string PositionT::AsString(void) const
+{
+	auto &Table = GetPositionTable();
+	PositionEntryT Entry;
+	{
+		std::lock_guard<std::mutex> Lock(Table.Mutex);
+		AssertLT(ID, Table.Entries.size());
+		Entry = Table.Entries[ID];
+	}
+	switch (Entry.Origin)
+	{
+		case PositionEntryT::OriginT::Invalid: return "invalid";
+		case PositionEntryT::OriginT::Hard: return ::StringT() << "(HARD)" << Entry.File << "/" << Entry.Function << ":" << Entry.Line;
+		case PositionEntryT::OriginT::Loaded: return ::StringT() << Entry.File << ":" << Entry.Offset;
+	}
+	return {};
+}
+
+//================================================================================================================
+// Symbols
+namespace
+{
+struct SymbolTableT
+{
+	std::mutex Mutex;
+	std::deque<std::string> Names;
+	std::unordered_map<std::string, uint32_t> Lookup;
+	
+	SymbolTableT(void) 
+	{ 
+		// Same order as PredefinedSymbolT
+		for (auto Name : {"", "input", "output"})
+		{
+			Lookup.emplace(Name, static_cast<uint32_t>(Names.size()));
+			Names.push_back(Name);
+		}
+	}
+};
+
+enum struct PredefinedSymbolT : uint32_t { Empty, Input, Output };
+
+SymbolTableT &GetSymbolTable(void)
+{
+	static SymbolTableT Table;
+	return Table;
+}
+}
+
+SymbolT::SymbolT(void) : ID(0) {}
+
+SymbolT::SymbolT(std::string const &Name)
+{
+	auto &Table = GetSymbolTable();
+	std::lock_guard<std::mutex> Lock(Table.Mutex);
+	auto Found = Table.Lookup.find(Name);
+	if (Found != Table.Lookup.end()) { ID = Found->second; return; }
+	AssertLT(Table.Names.size(), std::numeric_limits<uint32_t>::max());
+	ID = static_cast<uint32_t>(Table.Names.size());
+	Table.Names.push_back(Name);
+	Table.Lookup.emplace(Name, ID);
+}
+
+SymbolT SymbolT::Input(void) { SymbolT Out; Out.ID = static_cast<uint32_t>(PredefinedSymbolT::Input); return Out; }
+SymbolT SymbolT::Output(void) { SymbolT Out; Out.ID = static_cast<uint32_t>(PredefinedSymbolT::Output); return Out; }
+
+std::string const &SymbolT::Name(void) const
+{
+	auto &Table = GetSymbolTable();
+	std::lock_guard<std::mutex> Lock(Table.Mutex);
+	AssertLT(ID, Table.Names.size());
+	return Table.Names[ID];
+}
+
+bool SymbolT::operator ==(SymbolT const &Other) const { return ID == Other.ID; }
+bool SymbolT::operator !=(SymbolT const &Other) const { return ID != Other.ID; }
 
 //================================================================================================================
 // Core
+static thread_local std::vector<NucleusT *> *PendingFrees = nullptr;
+
+// Nuclei freed while another is being destroyed wait for the outermost Free, so freeing a deep tree doesn't recurse
+static void Free(NucleusT *Nucleus)
+{
+	if (PendingFrees)
+	{
+		PendingFrees->push_back(Nucleus);
+		return;
+	}
+	std::vector<NucleusT *> Pending;
+	PendingFrees = &Pending;
+	delete Nucleus;
+	while (!Pending.empty())
+	{
+		auto Next = Pending.back();
+		Pending.pop_back();
+		delete Next;
+	}
+	PendingFrees = nullptr;
+}
+
 void NucleusT::Replace(NucleusT *Replacement)
 {
-	auto OldAtoms = Atoms;
-	for (auto Atom : OldAtoms)
-		*Atom = Replacement;
+	Replacement = AtomT::Follow(Replacement);
+	if (Replacement == this) return;
+	Assert(!Forward);
+	if (!Atoms)
+	{
+		// Nothing would ever reach (and free) an unreferenced replacement, or this once it's been replaced by nothing
+		if (Replacement && !Replacement->Atoms) Free(Replacement);
+		if (!Replacement) Free(this);
+		return;
+	}
+	if (!Replacement)
+	{
+		while (Atoms) Atoms->Detach();
+		Free(this);
+		return;
+	}
+	// Referrers are moved over lazily as they're accessed, see AtomT::Resolve
+	Forward = Replacement;
+}
+
+template <typename NodeT> constexpr uint8_t InterfacesOf(void)
+{
+	return 
+		(std::is_base_of<TypeT, NodeT>::value ? InterfaceBitT<TypeT>::Bit : 0) |
+		(std::is_base_of<AssignableT, NodeT>::value ? InterfaceBitT<AssignableT>::Bit : 0) |
+		(std::is_base_of<LLVMLoadableT, NodeT>::value ? InterfaceBitT<LLVMLoadableT>::Bit : 0) |
+		(std::is_base_of<LLVMLoadableTypeT, NodeT>::value ? InterfaceBitT<LLVMLoadableTypeT>::Bit : 0) |
+		(std::is_base_of<LLVMAssignableTypeT, NodeT>::value ? InterfaceBitT<LLVMAssignableTypeT>::Bit : 0);
+}
+
+static uint8_t const KindInterfaces[] =
+{
+#define KINDINTERFACES(Name, Type) InterfacesOf<Type>(),
+	NUCLEUSKINDS(KINDINTERFACES)
+#undef KINDINTERFACES
+};
+
+NucleusT::NucleusT(PositionT const Position, KindT Kind) : 
+	Arena(CurrentArena), 
+	LivePrevious(nullptr), 
+	LiveNext(nullptr), 
+	Atoms(nullptr), 
+	Position(Position),
+	Kind(Kind),
+	Interfaces(KindInterfaces[static_cast<size_t>(Kind)])
+{
+	if (Arena)
+	{
+		LiveNext = Arena->Live;
+		if (LiveNext) LiveNext->LivePrevious = this;
+		Arena->Live = this;
+	}
+}
+
+NucleusT::~NucleusT(void) 
+{
+	if (Arena && !Arena->IsReleasing)
+	{
+		if (LivePrevious) LivePrevious->LiveNext = LiveNext;
+		else Arena->Live = LiveNext;
+		if (LiveNext) LiveNext->LivePrevious = LivePrevious;
+	}
 }
 
-NucleusT::NucleusT(PositionT const Position) : Position(Position) {}
+// Every allocation is prefixed with the arena it came from (or null for the heap), since the nucleus itself has 
+// been destroyed by the time it's deallocated.
+void *NucleusT::operator new(size_t Size)
+{
+	auto Arena = CurrentArena;
+	Size += ArenaT::Alignment;
+	AllocatedBytes += Size;
+	auto Memory = static_cast<char *>(Arena ? Arena->Allocate(Size) : ::operator new(Size));
+	*reinterpret_cast<ArenaT **>(Memory) = Arena;
+	return Memory + ArenaT::Alignment;
+}
 
-NucleusT::~NucleusT(void) {}
+void NucleusT::operator delete(void *Memory, size_t Size)
+{
+	auto Start = static_cast<char *>(Memory) - ArenaT::Alignment;
+	auto Arena = *reinterpret_cast<ArenaT **>(Start);
+	if (Arena) Arena->Free(Start, Size + ArenaT::Alignment);
+	else ::operator delete(Start);
+}
 
 AtomT NucleusT::Clone(void) { assert(false); return {}; }
 
-AtomT NucleusT::GetType(ContextT Context) { ERROR; }
+namespace
+{
+// Stands in for a node too deep to clone by recursing, until the outermost CloneNode clones it
+struct ClonePlaceholderT : UndefinedT
+{
+	ClonePlaceholderT(void) : UndefinedT(HARDPOSITION) {}
+	void Fill(NucleusT *Clone) { Replace(Clone); }
+};
+
+struct PendingCloneT
+{
+	ClonePlaceholderT *Placeholder;
+	AtomT Source;
+};
 
-void NucleusT::Simplify(ContextT Context) {}
+constexpr size_t MaxCloneDepth = 64;
+thread_local size_t CloneDepth = 0;
+thread_local std::vector<PendingCloneT> *PendingClones = nullptr;
+}
 
-void AtomT::Set(NucleusT *Nucleus)
+// Interned leaf types are never modified or replaced, so clones of a tree share them.  Any other type node is copied: 
+// simplifying it replaces it with its canonical instance, which must not reach back into the tree it was cloned from.
+// Clones recurse up to MaxCloneDepth; deeper nodes are cloned from a worklist by the outermost call.
+static AtomT CloneNode(AtomT &Node)
+{
+	switch (Node.Kind())
+	{
+		case KindT::NumericType: if ((*Node.As<NumericTypeT>())->Interned) return Node; break;
+		case KindT::StringType: if ((*Node.As<StringTypeT>())->Interned) return Node; break;
+		default: break;
+	}
+	if (CloneDepth == MaxCloneDepth)
+	{
+		auto Placeholder = new ClonePlaceholderT;
+		PendingClones->push_back(PendingCloneT{Placeholder, Node});
+		return Placeholder;
+	}
+	
+	std::vector<PendingCloneT> Pending;
+	bool const Outermost = !PendingClones;
+	if (Outermost) PendingClones = &Pending;
+	++CloneDepth;
+	auto Out = Node->Clone();
+	if (Outermost)
+	{
+		while (!Pending.empty())
+		{
+			auto Next = Pending.back();
+			Pending.pop_back();
+			Next.Placeholder->Fill(Next.Source->Clone());
+		}
+		PendingClones = nullptr;
+	}
+	--CloneDepth;
+	return Out;
+}
+
+AtomT NucleusT::GetType(ContextT const &Context) { ERROR; }
+
+void NucleusT::Schedule(SimplifyEngineT &Engine, ContextT const &Context) { Engine.Simplify(Context, this); }
+
+void NucleusT::Simplify(ContextT const &Context) {}
+
+void NucleusT::Trace(VisitT const &Visit) { Visit(Forward); }
+
+void AtomT::Attach(NucleusT *Nucleus)
 {
-	Clear();
 	this->Nucleus = Nucleus;
-	if (Nucleus)
-		Nucleus->Atoms.push_back(this);
+	Previous = nullptr;
+	Next = Nucleus->Atoms;
+	if (Next) Next->Previous = this;
+	Nucleus->Atoms = this;
+}
+
+void AtomT::Detach(void)
+{
+	if (Previous) Previous->Next = Next;
+	else Nucleus->Atoms = Next;
+	if (Next) Next->Previous = Previous;
+	Nucleus = nullptr;
+}
+
+NucleusT *AtomT::Follow(NucleusT *Nucleus)
+{
+	while (Nucleus && Nucleus->Forward) Nucleus = Nucleus->Forward.Nucleus;
+	return Nucleus;
+}
+
+NucleusT *AtomT::Resolve(void)
+{
+	// Compress the path so the next access is direct; the stub goes away once nothing passes through it
+	if (Nucleus && Nucleus->Forward) Set(Nucleus);
+	return Nucleus;
+}
+
+void AtomT::Set(NucleusT *Nucleus)
+{
+	Nucleus = Follow(Nucleus);
+	if (Nucleus == this->Nucleus) return;
+	// Attach before letting go of the old nucleus, in case it holds the only other reference to the new one
+	auto Old = this->Nucleus;
+	if (Old && ReleasingArena && (Old->Arena == ReleasingArena)) Old = nullptr;
+	else if (Old) Detach();
+	if (Nucleus) Attach(Nucleus);
+	else this->Nucleus = nullptr;
+	if (Old && !Old->Atoms)
+		Free(Old);
 }
 
 void AtomT::Clear(void)
 {
 	if (Nucleus) 
 	{
-		Nucleus->Atoms.erase(std::find(Nucleus->Atoms.begin(), Nucleus->Atoms.end(), this));
-		if (Nucleus->Atoms.empty())
-			delete Nucleus;
-		Nucleus = nullptr;
+		if (ReleasingArena && (Nucleus->Arena == ReleasingArena))
+		{
+			Nucleus = nullptr;
+			return;
+		}
+		auto Old = Nucleus;
+		Detach();
+		if (!Old->Atoms)
+			Free(Old);
 	}
 }
 
-AtomT::AtomT(void) : Nucleus(nullptr) {}
-AtomT::AtomT(NucleusT *Nucleus) : Nucleus(nullptr) { Set(Nucleus); }
-AtomT::AtomT(AtomT const &Other) : Nucleus(nullptr) { Set(Other.Nucleus); }
+AtomT::AtomT(void) : Nucleus(nullptr), Previous(nullptr), Next(nullptr) {}
+AtomT::AtomT(NucleusT *Nucleus) : Nucleus(nullptr), Previous(nullptr), Next(nullptr) { Set(Nucleus); }
+AtomT::AtomT(AtomT const &Other) : Nucleus(nullptr), Previous(nullptr), Next(nullptr) { Set(Other.Nucleus); }
 AtomT::~AtomT(void) { Clear(); }
 
 AtomT &AtomT::operator =(NucleusT *Nucleus) { Set(Nucleus); return *this; }
 AtomT &AtomT::operator =(AtomT &Other) { Set(Other.Nucleus); return *this; }
+AtomT &AtomT::operator =(AtomT &&Other) { Set(Other.Nucleus); return *this; }
 
-AtomT::operator NucleusT *(void) { return Nucleus; }
+AtomT::operator NucleusT *(void) { return Resolve(); }
 AtomT::operator bool(void) const { return Nucleus; }
 bool AtomT::operator !(void) const { return !Nucleus; }
 
-NucleusT *AtomT::operator ->(void) { return Nucleus; }
+KindT AtomT::Kind(void) const 
+{ 
+	auto Nucleus = Follow(this->Nucleus);
+	Assert(Nucleus);
+	return Nucleus->Kind; 
+}
+
+NucleusT *AtomT::operator ->(void) { return Resolve(); }
 
 ContextT::ContextT(
 	llvm::LLVMContext &LLVM, 
 	llvm::Module *Module, 
 	llvm::BasicBlock *Block, 
-	AtomT Scope,
+	NucleusT *Scope,
 	PositionT Position,
 	bool IsConstant) : 
 	LLVM(LLVM), 
@@ -75,17 +626,131 @@ ContextT::ContextT(
 	Block(Block),
 	Scope(Scope),
 	Position(Position),
-	IsConstant(IsConstant)
-	{}
-		
-ContextT::ContextT(ContextT const &Context) : 
-	LLVM(Context.LLVM), 
-	Module(Context.Module),
-	Block(Context.Block),
-	Scope(Context.Scope),
-	Position(Context.Position),
-	IsConstant(Context.IsConstant)
+	IsConstant(IsConstant),
+	Types(nullptr),
+	Dependencies(nullptr),
+	Budget(nullptr)
 	{}
+
+ContextT ContextT::WithModule(llvm::Module *Module) const { auto Out = *this; Out.Module = Module; return Out; }
+ContextT ContextT::WithBlock(llvm::BasicBlock *Block) const { auto Out = *this; Out.Block = Block; return Out; }
+ContextT ContextT::WithScope(NucleusT *Scope) const { auto Out = *this; Out.Scope = Scope; return Out; }
+ContextT ContextT::WithPosition(PositionT Position) const { auto Out = *this; Out.Position = Position; return Out; }
+ContextT ContextT::WithConstant(bool IsConstant) const { auto Out = *this; Out.IsConstant = IsConstant; return Out; }
+ContextT ContextT::WithTypes(TypeInternerT *Types) const { auto Out = *this; Out.Types = Types; return Out; }
+ContextT ContextT::WithDependencies(StatementDependenciesT *Dependencies) const 
+	{ auto Out = *this; Out.Dependencies = Dependencies; return Out; }
+ContextT ContextT::WithBudget(EvaluationBudgetT *Budget) const { auto Out = *this; Out.Budget = Budget; return Out; }
+
+namespace
+{
+// FNV-1a
+struct FingerprintT
+{
+	uint64_t Hash;
+	
+	FingerprintT(void) : Hash(14695981039346656037ull) {}
+	
+	void Mix(void const *Data, size_t Length)
+	{
+		for (size_t Index = 0; Index < Length; ++Index)
+		{
+			Hash ^= static_cast<uint8_t const *>(Data)[Index];
+			Hash *= 1099511628211ull;
+		}
+	}
+	
+	template <typename ValueT> void Mix(ValueT const &Value) { Mix(&Value, sizeof(Value)); }
+	
+	void Mix(std::string const &Value)
+	{
+		Mix(Value.size());
+		Mix(Value.data(), Value.size());
+	}
+};
+}
+
+static thread_local SimplifyEngineT *CurrentEngine = nullptr;
+
+SimplifyEngineT::SimplifyEngineT(void) {}
+
+void SimplifyEngineT::Run(ContextT const &Context, AtomT Node)
+{
+	SimplifyEngineT Engine;
+	Engine.Schedule(Context, Node);
+	Engine.Finish();
+}
+
+void SimplifyEngineT::Nest(std::function<void(SimplifyEngineT &Engine)> const &Queue)
+{
+	if (CurrentEngine) 
+	{
+		Queue(*CurrentEngine);
+		return;
+	}
+	SimplifyEngineT Engine;
+	Queue(Engine);
+	Engine.Finish();
+}
+
+void SimplifyEngineT::Finish(void)
+{
+	struct RestoreT { SimplifyEngineT *Outer; ~RestoreT(void) { CurrentEngine = Outer; } } Restore{CurrentEngine};
+	CurrentEngine = this;
+	while (!Tasks.empty())
+	{
+		auto Task = Tasks.back();
+		Tasks.pop_back();
+		if (Task.Context.Budget) Task.Context.Budget->Step(Task.Context);
+		switch (Task.Step)
+		{
+			case TaskT::StepT::Schedule: Task.Node->Schedule(*this, Task.Context); break;
+			case TaskT::StepT::Simplify: Task.Node->Simplify(Task.Context); break;
+			case TaskT::StepT::Assign: Task.Node.As<AssignableT>()->Assign(Task.Context, Task.Other); break;
+			case TaskT::StepT::Continue:
+			{
+				auto Step = std::move(Continuations.back());
+				Continuations.pop_back();
+				Step();
+				break;
+			}
+		}
+	}
+}
+
+void SimplifyEngineT::Schedule(ContextT const &Context, AtomT Node) 
+	{ Tasks.push_back(TaskT{TaskT::StepT::Schedule, Node, {}, Context}); }
+
+void SimplifyEngineT::Simplify(ContextT const &Context, AtomT Node) 
+	{ Tasks.push_back(TaskT{TaskT::StepT::Simplify, Node, {}, Context}); }
+
+void SimplifyEngineT::Assign(ContextT const &Context, AtomT Node, AtomT Other) 
+	{ Tasks.push_back(TaskT{TaskT::StepT::Assign, Node, Other, Context}); }
+
+void SimplifyEngineT::Continue(ContextT const &Context, std::function<void(void)> &&Step)
+{
+	Tasks.push_back(TaskT{TaskT::StepT::Continue, {}, {}, Context});
+	Continuations.push_back(std::move(Step));
+}
+
+EvaluationBudgetT::EvaluationBudgetT(void) : 
+	MaxSteps(1 << 24), MaxBytes(1 << 28), Evaluated(0), Depth(0), Steps(0), StartBytes(0) {}
+
+EvaluationBudgetT::ScopeT::ScopeT(EvaluationBudgetT *Budget) : Budget(Budget)
+{
+	if (!Budget || Budget->Depth++ > 0) return;
+	Budget->Steps = 0;
+	Budget->StartBytes = AllocatedBytes;
+}
+
+EvaluationBudgetT::ScopeT::~ScopeT(void) { if (Budget) --Budget->Depth; }
+
+void EvaluationBudgetT::Step(ContextT const &Context)
+{
+	if (Depth == 0) return;
+	if (++Steps > MaxSteps) ERROR;
+	if (AllocatedBytes - StartBytes > MaxBytes) ERROR;
+}
 	
 //================================================================================================================
 // Interfaces
@@ -97,32 +762,44 @@ LLVMLoadableTypeT::~LLVMLoadableTypeT(void) {}
 
 //================================================================================================================
 // Basics
-UndefinedT::UndefinedT(PositionT const Position) : NucleusT(Position) {}
+UndefinedT::UndefinedT(PositionT const Position) : NucleusT(Position, KindT::Undefined) {}
 
-void UndefinedT::Assign(ContextT Context, AtomT Other)
+void UndefinedT::Assign(ContextT const &Context, AtomT Other)
 {
 	Replace(Other);
 }
 
-ImplementT::ImplementT(PositionT const Position) : NucleusT(Position) {}
+ImplementT::ImplementT(PositionT const Position) : NucleusT(Position, KindT::Implement) {}
 
 AtomT ImplementT::Clone(void)
 {
 	auto Out = new ImplementT(Position);
 	if (Type)
-		Out->Type = Type->Clone();
+		Out->Type = CloneNode(Type);
 	if (Value)
-		Out->Value = Value->Clone();
+		Out->Value = CloneNode(Value);
 	return Out;
 }
 
-AtomT ImplementT::GetType(ContextT Context) { return Type; }
+void ImplementT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Type);
+	Visit(Value);
+}
+
+AtomT ImplementT::GetType(ContextT const &Context) { return Type; }
 
-void ImplementT::Simplify(ContextT Context)
+void ImplementT::Schedule(SimplifyEngineT &Engine, ContextT const &Context)
+{
+	Engine.Simplify(Context, this);
+	if (Type) Engine.Schedule(Context, Type);
+	Engine.Schedule(Context, Value);
+}
+
+void ImplementT::Simplify(ContextT const &Context)
 {
-	Value->Simplify(Context);
 	if (!Type) Type = Value->GetType(Context);
-	else Type->Simplify(Context);
 	auto Allocable = Type.As<TypeT>();
 	if (!Allocable) ERROR;
 	Replace(Allocable->Allocate(Context, Value));
@@ -134,7 +811,7 @@ LLVMAssignableTypeT::~LLVMAssignableTypeT(void) {}
 
 TypeT::~TypeT(void) {}
 
-StringT::StringT(PositionT const Position) : NucleusT(Position), Initialized(false) {}
+StringT::StringT(PositionT const Position) : NucleusT(Position, KindT::String), Initialized(false) {}
 
 AtomT StringT::Clone(void)
 {
@@ -145,18 +822,33 @@ AtomT StringT::Clone(void)
 	return Out;
 }
 
-AtomT StringT::GetType(ContextT Context)
+void StringT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Type);
+}
+
+AtomT StringT::GetType(ContextT const &Context)
 {
-	if (!Type) Type = new StringT(Position);
+	if (!Type) 
+	{
+		if (Context.Types) Type = Context.Types->String(Position, DefaultTypeID, true);
+		else Type = new StringTypeT(Position);
+	}
 	return Type;
 }
 
-void StringT::Assign(ContextT Context, AtomT Other)
+void StringT::Simplify(ContextT const &Context)
+{
+	if (Type && Context.Types) Type = Context.Types->Intern(Type);
+}
+
+void StringT::Assign(ContextT const &Context, AtomT Other)
 {
 	GetType(Context).As<StringTypeT>()->Assign(Context, Initialized, Data, Other);
 }
 
-StringTypeT::StringTypeT(PositionT const Position) : NucleusT(Position), ID(DefaultTypeID), Static(true) {}
+StringTypeT::StringTypeT(PositionT const Position) : NucleusT(Position, KindT::StringType), ID(DefaultTypeID), Static(true), Interned(false) {}
 
 AtomT StringTypeT::Clone(void)
 {
@@ -166,19 +858,25 @@ AtomT StringTypeT::Clone(void)
 	return Out;
 }
 
+void StringTypeT::Simplify(ContextT const &Context)
+{
+	if (Context.Types && !Interned) Replace(Context.Types->Intern(this));
+}
+
 bool StringTypeT::IsDynamic(void)
 {
 	return false;
 }
 
-void StringTypeT::CheckType(ContextT Context, AtomT Other)
+void StringTypeT::CheckType(ContextT const &Context, AtomT Other)
 {
 	auto OtherType = Other->GetType(Context).As<StringTypeT>();
 	if (!OtherType) ERROR;
+	if (*OtherType == this) return;
 	if (OtherType->ID != ID) ERROR;
 }
 	
-AtomT StringTypeT::Allocate(ContextT Context, AtomT Value)
+AtomT StringTypeT::Allocate(ContextT const &Context, AtomT Value)
 {
 	auto Out = new StringT(Context.Position);
 	Out->Type = this;
@@ -195,7 +893,7 @@ AtomT StringTypeT::Allocate(ContextT Context, AtomT Value)
 	return Out;
 }
 
-void StringTypeT::Assign(ContextT Context, bool &Initialized, std::string &Data, AtomT Other)
+void StringTypeT::Assign(ContextT const &Context, bool &Initialized, std::string &Data, AtomT Other)
 {
 	CheckType(Context, Other);
 	if (Initialized && Static) ERROR;
@@ -206,7 +904,7 @@ void StringTypeT::Assign(ContextT Context, bool &Initialized, std::string &Data,
 	Initialized = true;
 }
 
-template <typename DataT> NumericT<DataT>::NumericT(PositionT const Position) : NucleusT(Position), Initialized(false) {}
+template <typename DataT> NumericT<DataT>::NumericT(PositionT const Position) : NucleusT(Position, KindOfT<NumericT<DataT>>::Kind), Initialized(false) {}
 
 template <typename DataT> AtomT NumericT<DataT>::Clone(void)
 {
@@ -217,23 +915,39 @@ template <typename DataT> AtomT NumericT<DataT>::Clone(void)
 	return Out;
 }
 
+template <typename DataT> void NumericT<DataT>::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Type);
+}
+
 NumericTypeT::DataTypeT GetDataType(ExplicitT<int32_t>) { return NumericTypeT::DataTypeT::Int; }
 NumericTypeT::DataTypeT GetDataType(ExplicitT<uint32_t>) { return NumericTypeT::DataTypeT::UInt; }
 NumericTypeT::DataTypeT GetDataType(ExplicitT<float>) { return NumericTypeT::DataTypeT::Float; }
 NumericTypeT::DataTypeT GetDataType(ExplicitT<double>) { return NumericTypeT::DataTypeT::Double; }
 
-template <typename DataT> AtomT NumericT<DataT>::GetType(ContextT Context)
+template <typename DataT> AtomT NumericT<DataT>::GetType(ContextT const &Context)
 {
 	if (!Type) 
 	{
-		auto Temp = new NumericTypeT(Position);
-		Temp->DataType = GetDataType(ExplicitT<DataT>());
-		Type = Temp;
+		auto DataType = GetDataType(ExplicitT<DataT>());
+		if (Context.Types) Type = Context.Types->Numeric(Position, DefaultTypeID, true, true, DataType);
+		else
+		{
+			auto Temp = new NumericTypeT(Position);
+			Temp->DataType = DataType;
+			Type = Temp;
+		}
 	}
 	return Type;
 }
 
-template <typename DataT> void NumericT<DataT>::Assign(ContextT Context, AtomT Other)
+template <typename DataT> void NumericT<DataT>::Simplify(ContextT const &Context)
+{
+	if (Type && Context.Types) Type = Context.Types->Intern(Type);
+}
+
+template <typename DataT> void NumericT<DataT>::Assign(ContextT const &Context, AtomT Other)
 {
 	auto Type = GetType(Context).template As<NumericTypeT>();
 	Type->CheckType(Context, Other);
@@ -242,9 +956,10 @@ template <typename DataT> void NumericT<DataT>::Assign(ContextT Context, AtomT O
 	if (!Number) ERROR;
 	if (!Number->Initialized) ERROR;
 	Data = Number->Data;
+	Initialized = true;
 }
 
-template <> llvm::Value *NumericT<float>::GenerateLLVMLoad(ContextT Context)
+template <> llvm::Value *NumericT<float>::GenerateLLVMLoad(ContextT const &Context)
 {
 	if (!Initialized) ERROR;
 	return llvm::ConstantFP::get
@@ -254,7 +969,7 @@ template <> llvm::Value *NumericT<float>::GenerateLLVMLoad(ContextT Context)
 		);
 }
 
-template <> llvm::Value *NumericT<double>::GenerateLLVMLoad(ContextT Context)
+template <> llvm::Value *NumericT<double>::GenerateLLVMLoad(ContextT const &Context)
 {
 	if (!Initialized) ERROR;
 	return llvm::ConstantFP::get
@@ -264,7 +979,7 @@ template <> llvm::Value *NumericT<double>::GenerateLLVMLoad(ContextT Context)
 		);
 }
 
-template <typename DataT> llvm::Value *NumericT<DataT>::GenerateLLVMLoad(ContextT Context)
+template <typename DataT> llvm::Value *NumericT<DataT>::GenerateLLVMLoad(ContextT const &Context)
 {
 	if (!Initialized) ERROR;
 	return llvm::ConstantInt::get
@@ -275,11 +990,17 @@ template <typename DataT> llvm::Value *NumericT<DataT>::GenerateLLVMLoad(Context
 		);
 }
 
-DynamicT::DynamicT(PositionT const Position) : NucleusT(Position), Initialized(false), Target(nullptr) {}
+DynamicT::DynamicT(PositionT const Position) : NucleusT(Position, KindT::Dynamic), Initialized(false), Target(nullptr) {}
+
+void DynamicT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Type);
+}
 
-AtomT DynamicT::GetType(ContextT Context) { return Type; }
+AtomT DynamicT::GetType(ContextT const &Context) { return Type; }
 
-llvm::Value *DynamicT::GetTarget(ContextT Context)
+llvm::Value *DynamicT::GetTarget(ContextT const &Context)
 {
 	if (!Target)
 	{
@@ -303,14 +1024,14 @@ llvm::Value *DynamicT::GetTarget(ContextT Context)
 	return Target;
 }
 
-void DynamicT::Assign(ContextT Context, AtomT Other)
+void DynamicT::Assign(ContextT const &Context, AtomT Other)
 {
 	auto Type = GetType(Context).As<LLVMAssignableTypeT>();
 	if (!Type) ERROR;
 	Type->AssignLLVM(Context, Initialized, GetTarget(Context), Other);
 }
 
-llvm::Value *DynamicT::GenerateLLVMLoad(ContextT Context)
+llvm::Value *DynamicT::GenerateLLVMLoad(ContextT const &Context)
 {
 	if (!Initialized) ERROR;
 	return new llvm::LoadInst(GetTarget(Context), "", Context.Block); 
@@ -419,7 +1140,7 @@ llvm::Value *GenerateLLVMNumericConversion(llvm::BasicBlock *Block, llvm::Value
 	}
 }
 
-NumericTypeT::NumericTypeT(PositionT const Position) : NucleusT(Position), ID(DefaultTypeID), Constant(true), Static(true), DataType(DataTypeT::Int) {}
+NumericTypeT::NumericTypeT(PositionT const Position) : NucleusT(Position, KindT::NumericType), ID(DefaultTypeID), Constant(true), Static(true), DataType(DataTypeT::Int), Interned(false) {}
 
 AtomT NumericTypeT::Clone(void)
 {
@@ -427,9 +1148,15 @@ AtomT NumericTypeT::Clone(void)
 	Out->ID = ID;
 	Out->Constant = Constant;
 	Out->Static = Static;
+	Out->DataType = DataType;
 	return Out;
 }
 
+void NumericTypeT::Simplify(ContextT const &Context)
+{
+	if (Context.Types && !Interned) Replace(Context.Types->Intern(this));
+}
+
 bool NumericTypeT::IsDynamic(void) 
 {
 	return !Constant;
@@ -440,10 +1167,11 @@ bool NumericTypeT::IsSigned(void) const
 	return DataType == DataTypeT::Int;
 }
 
-void NumericTypeT::CheckType(ContextT Context, AtomT Other)
+void NumericTypeT::CheckType(ContextT const &Context, AtomT Other)
 {
 	auto OtherType = Other->GetType(Context).As<NumericTypeT>();
 	if (!OtherType) ERROR;
+	if (*OtherType == this) return;
 	if (OtherType->ID != ID) ERROR;
 	if (ID == DefaultTypeID)
 	{
@@ -457,23 +1185,28 @@ void NumericTypeT::CheckType(ContextT Context, AtomT Other)
 	}
 }
 
-template <typename BaseT> AtomT NumericTypeConstantAssign(ContextT Context, NumericTypeT &Type, AtomT Value)
+template <typename BaseT> AtomT NumericTypeConstantAssign(ContextT const &Context, NumericTypeT &Type, AtomT Value)
 {
 	auto Out = new NumericT<BaseT>(Context.Position);
 	Out->Type = &Type;
 	if (Value)
 	{
-		if (auto Number = Value.As<NumericT<int32_t>>()) { if (!Number->Initialized) ERROR; Out->Data = Number->Data; }
-		else if (auto Number = Value.As<NumericT<uint32_t>>()) { if (!Number->Initialized) ERROR; Out->Data = Number->Data; }
-		else if (auto Number = Value.As<NumericT<float>>()) { if (!Number->Initialized) ERROR; Out->Data = Number->Data; }
-		else if (auto Number = Value.As<NumericT<double>>()) { if (!Number->Initialized) ERROR; Out->Data = Number->Data; }
-		else ERROR;
+		bool Initialized = false;
+		switch (Value.Kind())
+		{
+			case KindT::Int: { auto Number = *Value.As<NumericT<int32_t>>(); Initialized = Number->Initialized; Out->Data = Number->Data; break; }
+			case KindT::UInt: { auto Number = *Value.As<NumericT<uint32_t>>(); Initialized = Number->Initialized; Out->Data = Number->Data; break; }
+			case KindT::Float: { auto Number = *Value.As<NumericT<float>>(); Initialized = Number->Initialized; Out->Data = Number->Data; break; }
+			case KindT::Double: { auto Number = *Value.As<NumericT<double>>(); Initialized = Number->Initialized; Out->Data = Number->Data; break; }
+			default: ERROR;
+		}
+		if (!Initialized) ERROR;
 		Out->Initialized = true;
 	}
 	return Out;
 }
 
-AtomT NumericTypeT::Allocate(ContextT Context, AtomT Value)
+AtomT NumericTypeT::Allocate(ContextT const &Context, AtomT Value)
 {
 	if (Constant)
 	{
@@ -488,8 +1221,6 @@ AtomT NumericTypeT::Allocate(ContextT Context, AtomT Value)
 	}
 	else 
 	{
-		Context.IsConstant = false;
-		
 		auto Out = new DynamicT(Context.Position);
 		Out->Type = this;
 		
@@ -521,7 +1252,7 @@ AtomT NumericTypeT::Allocate(ContextT Context, AtomT Value)
 	}
 }
 
-void NumericTypeT::AssignLLVM(ContextT Context, bool &Initialized, llvm::Value *Target, AtomT Other)
+void NumericTypeT::AssignLLVM(ContextT const &Context, bool &Initialized, llvm::Value *Target, AtomT Other)
 {
 	CheckType(Context, Other);
 	if (Initialized && Static) ERROR;
@@ -531,186 +1262,542 @@ void NumericTypeT::AssignLLVM(ContextT Context, bool &Initialized, llvm::Value *
 	new llvm::StoreInst(Loadable->GenerateLLVMLoad(Context), Target, Context.Block);
 }
 
-llvm::Type *NumericTypeT::GenerateLLVMType(ContextT Context)
+llvm::Type *GenerateLLVMNumericType(ContextT const &Context, NumericTypeT::DataTypeT DataType)
 {
 	switch (DataType)
 	{
-		case DataTypeT::Int: 
-		case DataTypeT::UInt:
+		case NumericTypeT::DataTypeT::Int: 
+		case NumericTypeT::DataTypeT::UInt:
 			return llvm::IntegerType::get(Context.LLVM, 32);
-		case DataTypeT::Float:
+		case NumericTypeT::DataTypeT::Float:
 			return llvm::Type::getFloatTy(Context.LLVM);
-		case DataTypeT::Double:
+		case NumericTypeT::DataTypeT::Double:
 			return llvm::Type::getDoubleTy(Context.LLVM);
 		default: assert(false); return nullptr;
 	}
 }
 
+llvm::Type *NumericTypeT::GenerateLLVMType(ContextT const &Context)
+{
+	return GenerateLLVMNumericType(Context, DataType);
+}
+
 //================================================================================================================
 // Groups
-OptionalT<AtomT> GroupCollectionT::GetByKey(std::string const &Key)
+GroupCollectionT::IteratorT::IteratorT(std::vector<MemberT> &Members, std::vector<uint32_t>::const_iterator Position) : 
+	Members(Members), Position(Position) {}
+
+auto GroupCollectionT::IteratorT::operator *(void) const -> MemberT & { return Members[*Position]; }
+auto GroupCollectionT::IteratorT::operator ->(void) const -> MemberT * { return &Members[*Position]; }
+auto GroupCollectionT::IteratorT::operator ++(void) -> IteratorT & { ++Position; return *this; }
+bool GroupCollectionT::IteratorT::operator !=(IteratorT const &Other) const { return Position != Other.Position; }
+
+OptionalT<uint32_t> GroupCollectionT::Find(SymbolT const Key) const
 {
-	auto Found = Keys.find(Key);
-	if (Found == Keys.end()) return {};
+	if (Members.size() <= IndexThreshold)
+	{
+		for (uint32_t Member = 0; Member < Members.size(); ++Member)
+			if (Members[Member].first == Key) return Member;
+		return {};
+	}
+	auto Found = Index.find(Key);
+	if (Found == Index.end()) return {};
 	return Found->second;
 }
 
-void GroupCollectionT::Add(std::string const &Key, AtomT Value)
+OptionalT<AtomT> GroupCollectionT::GetByKey(SymbolT const Key)
 {
-	auto Found = Keys.find(Key);
-	Assert(Found == Keys.end());
-	Keys[Key] = Value;
+	auto Found = Find(Key);
+	if (!Found) return {};
+	return Members[*Found].second;
+}
+
+void GroupCollectionT::Add(SymbolT const Key, AtomT Value)
+{
+	Assert(!Find(Key));
+	auto const Member = static_cast<uint32_t>(Members.size());
+	Members.emplace_back(Key, Value);
+	Names.push_back(&Key.Name());
+	
+	auto const &Name = *Names.back();
+	auto Position = std::upper_bound(Order.begin(), Order.end(), Name, 
+		[this](std::string const &Name, uint32_t Other) { return Name < *Names[Other]; });
+	Order.insert(Position, Member);
+	
+	if (Members.size() == IndexThreshold + 1)
+	{
+		for (uint32_t Other = 0; Other < Members.size(); ++Other)
+			Index.emplace(Members[Other].first, Other);
+	}
+	else if (Members.size() > IndexThreshold + 1) Index.emplace(Key, Member);
 }
 
-auto GroupCollectionT::begin(void) -> decltype(Keys.begin()) { return Keys.begin(); }
-auto GroupCollectionT::end(void) -> decltype(Keys.end()) { return Keys.end(); }
+size_t GroupCollectionT::size(void) const { return Members.size(); }
+auto GroupCollectionT::begin(void) -> IteratorT { return {Members, Order.begin()}; }
+auto GroupCollectionT::end(void) -> IteratorT { return {Members, Order.end()}; }
 
-GroupT::GroupT(PositionT const Position) : NucleusT(Position) {}
+GroupT::GroupT(PositionT const Position) : NucleusT(Position, KindT::Group) {}
 
 AtomT GroupT::Clone(void)
 {
 	auto Out = new GroupT(Position);
 	for (auto &Statement : Statements)
-		Out->Statements.push_back(Statement->Clone());
+		Out->Statements.push_back(CloneNode(Statement));
 	for (auto &Pair : *this)
-		Out->Add(Pair.first, Pair.second->Clone());
+		Out->Add(Pair.first, CloneNode(Pair.second));
 	return Out;
 }
 
-void GroupT::Simplify(ContextT Context)
+void GroupT::Trace(VisitT const &Visit)
 {
-	Context.Scope = this;
+	NucleusT::Trace(Visit);
 	for (auto &Statement : Statements)
-		Statement->Simplify(Context);
+		Visit(Statement);
+	for (auto &Member : *this)
+		Visit(Member.second);
+}
+
+void GroupT::Schedule(SimplifyEngineT &Engine, ContextT const &OuterContext)
+{
+	auto Context = OuterContext.WithScope(this);
+	for (auto Statement = Statements.rbegin(); Statement != Statements.rend(); ++Statement)
+		Engine.Schedule(Context, *Statement);
 }
 
-void GroupT::Assign(ContextT Context, AtomT Other)
+void GroupT::Assign(ContextT const &OuterContext, AtomT Other)
 {
-	Context.Scope = this;
+	auto Context = OuterContext.WithScope(this);
 	auto Group = Other.As<GroupT>();
 	if (!Group) ERROR;
-	for (auto &Pair : *this)
+	// Nested groups are assigned as tasks so their depth doesn't recurse
+	SimplifyEngineT::Nest([&](SimplifyEngineT &Engine)
 	{
-		auto Dest = Pair.second.As<AssignableT>();
-		if (!Dest) ERROR;
-		auto Source = Group->GetByKey(Pair.first);
-		if (!Source) ERROR;
-		Dest->Assign(Context, *Source);
-	}
+		for (auto &Pair : *this)
+		{
+			auto Dest = Pair.second.As<AssignableT>();
+			if (!Dest) ERROR;
+			auto Source = Group->GetByKey(Pair.first);
+			if (!Source) ERROR;
+			if (Pair.second.Kind() == KindT::Group) Engine.Assign(Context, Pair.second, *Source);
+			else Dest->Assign(Context, *Source);
+		}
+	});
 }
 
-AtomT GroupT::AccessElement(ContextT Context, std::string const &Key)
+AtomT GroupT::AccessElement(ContextT const &Context, SymbolT const Key)
 {
 	auto Got = GetByKey(Key);
+	if (Context.Dependencies && (Context.Dependencies->Top == this)) 
+		Context.Dependencies->Access(Key, Got ? static_cast<NucleusT *>(*Got) : nullptr);
 	if (Got) return *Got;
 	auto Out = new UndefinedT(Context.Position);
 	Add(Key, Out);
 	return Out;
 }
 
-AtomT GroupT::AccessElement(ContextT Context, AtomT Key)
+AtomT GroupT::AccessElement(ContextT const &Context, AtomT Key)
 {
 	auto KeyString = Key.As<StringT>();
 	if (!KeyString) ERROR;
-	return AccessElement(Context, KeyString->Data);
+	return AccessElement(Context, SymbolT(KeyString->Data));
 }
 
-BlockT::BlockT(PositionT const Position) : NucleusT(Position) {}
+BlockT::BlockT(PositionT const Position) : NucleusT(Position, KindT::Block) {}
 
 AtomT BlockT::Clone(void) 
 {
 	auto Out = new BlockT(Position);
 	for (auto &Statement : Statements)
-		Out->Statements.push_back(Statement->Clone());
+		Out->Statements.push_back(CloneNode(Statement));
 	return Out;
 }
 
-void BlockT::Simplify(ContextT Context) {}
+void BlockT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	for (auto &Statement : Statements)
+		Visit(Statement);
+}
+
+void BlockT::Simplify(ContextT const &Context) {}
 
 AtomT BlockT::CloneGroup(void)
 {
 	auto Out = new GroupT(Position);
 	for (auto &Statement : Statements)
-		Out->Statements.push_back(Statement->Clone());
+		Out->Statements.push_back(CloneNode(Statement));
 	return Out;
 }
 
-ElementT::ElementT(PositionT const Position) : NucleusT(Position) {}
+ElementT::ElementT(PositionT const Position) : NucleusT(Position, KindT::Element) {}
 
 AtomT ElementT::Clone(void)
 {
 	auto Out = new ElementT(Position);
 	if (Base)
-		Out->Base = Base->Clone();
+		Out->Base = CloneNode(Base);
 	if (Key)
-		Out->Key = Key->Clone();
+		Out->Key = CloneNode(Key);
+	Out->Name = Name;
 	return Out;
 }
 
-void ElementT::Simplify(ContextT Context)
+void ElementT::Trace(VisitT const &Visit)
 {
+	NucleusT::Trace(Visit);
+	Visit(Base);
+	Visit(Key);
+}
+
+void ElementT::Schedule(SimplifyEngineT &Engine, ContextT const &Context)
+{
+	Engine.Simplify(Context, this);
+	if (Key) Engine.Schedule(Context, Key);
 	if (!Base) Base = Context.Scope;
-	else Base->Simplify(Context);
-	Key->Simplify(Context);
+	else Engine.Schedule(Context, Base);
+}
+
+void ElementT::Simplify(ContextT const &Context)
+{
 	auto Group = Base.As<GroupT>();
 	if (!Group) ERROR;
-	Replace(Group->AccessElement(Context, Key));
+	if (!Key) Replace(Group->AccessElement(Context, Name));
+	else Replace(Group->AccessElement(Context, Key));
 }
 
 //================================================================================================================
 // Type manipulations
-AsDynamicTypeT::AsDynamicTypeT(PositionT const Position) : NucleusT(Position) {}
+AsDynamicTypeT::AsDynamicTypeT(PositionT const Position) : NucleusT(Position, KindT::AsDynamicType) {}
 
 AtomT AsDynamicTypeT::Clone(void)
 {
 	auto Out = new AsDynamicTypeT(Position);
 	if (Type)
-		Out->Type = Type->Clone();
+		Out->Type = CloneNode(Type);
+	return Out;
+}
+
+void AsDynamicTypeT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Type);
+}
+
+void AsDynamicTypeT::Schedule(SimplifyEngineT &Engine, ContextT const &Context)
+{
+	Engine.Simplify(Context, this);
+	Engine.Schedule(Context, Type);
+}
+
+void AsDynamicTypeT::Simplify(ContextT const &Context) 
+{
+	auto NewType = Type->Clone();
+	if (auto Numeric = NewType.As<NumericTypeT>())
+	{
+		Numeric->Constant = false;
+	}
+	else if (auto FunctionType = NewType.As<FunctionTypeT>())
+	{
+		FunctionType->Constant = false;
+	}
+	else ERROR;
+	if (Context.Types) NewType = Context.Types->Intern(NewType);
+	Replace(NewType);
+}
+
+//================================================================================================================
+// Statements
+AssignmentT::AssignmentT(PositionT const Position) : NucleusT(Position, KindT::Assignment) {}
+
+AtomT AssignmentT::Clone(void)
+{
+	auto Out = new AssignmentT(Position);
+	Out->Left = CloneNode(Left);
+	Out->Right = CloneNode(Right);
+	return Out;
+}
+
+void AssignmentT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Left);
+	Visit(Right);
+}
+
+void AssignmentT::Schedule(SimplifyEngineT &Engine, ContextT const &OuterContext)
+{
+	auto Context = OuterContext.WithPosition(Position);
+	Engine.Simplify(Context, this);
+	Engine.Schedule(Context, Right);
+	Engine.Schedule(Context, Left);
+}
+
+void AssignmentT::Simplify(ContextT const &Context)
+{
+	auto Assignable = Left.As<AssignableT>();
+	if (!Assignable) ERROR;
+	Assignable->Assign(Context, Right);
+}
+
+//================================================================================================================
+// Operations
+namespace
+{
+typedef BinaryOperationT::OperatorT OperatorT;
+typedef NumericTypeT::DataTypeT DataTypeT;
+
+bool IsComparison(OperatorT Operator) { return (Operator >= OperatorT::Equal) && (Operator <= OperatorT::GreaterEqual); }
+bool IsBitwise(OperatorT Operator) { return Operator >= OperatorT::And; }
+
+DataTypeT PromoteDataType(DataTypeT Left, DataTypeT Right)
+{
+	if ((Left == DataTypeT::Double) || (Right == DataTypeT::Double)) return DataTypeT::Double;
+	if ((Left == DataTypeT::Float) || (Right == DataTypeT::Float)) return DataTypeT::Float;
+	if ((Left == DataTypeT::UInt) && (Right == DataTypeT::UInt)) return DataTypeT::UInt;
+	return DataTypeT::Int;
+}
+
+template <typename FromT, typename DataT> bool ConstantData(AtomT &Operand, DataT &Out)
+{
+	auto Number = *Operand.As<NumericT<FromT>>();
+	if (!Number->Initialized) return false;
+	Out = static_cast<DataT>(Number->Data);
+	return true;
+}
+
+// False if the operand isn't an initialized constant
+template <typename DataT> bool ConstantOperand(AtomT &Operand, DataT &Out)
+{
+	switch (Operand.Kind())
+	{
+		case KindT::Int: return ConstantData<int32_t>(Operand, Out);
+		case KindT::UInt: return ConstantData<uint32_t>(Operand, Out);
+		case KindT::Float: return ConstantData<float>(Operand, Out);
+		case KindT::Double: return ConstantData<double>(Operand, Out);
+		default: return false;
+	}
+}
+
+template <typename DataT> bool FoldComparison(OperatorT Operator, DataT Left, DataT Right)
+{
+	switch (Operator)
+	{
+		case OperatorT::Equal: return Left == Right;
+		case OperatorT::NotEqual: return Left != Right;
+		case OperatorT::Less: return Left < Right;
+		case OperatorT::LessEqual: return Left <= Right;
+		case OperatorT::Greater: return Left > Right;
+		case OperatorT::GreaterEqual: return Left >= Right;
+		default: assert(false); return false;
+	}
+}
+
+template <typename DataT, typename Enable = void> struct FoldArithmeticT
+{
+	static DataT Fold(ContextT const &Context, OperatorT Operator, DataT Left, DataT Right)
+	{
+		switch (Operator)
+		{
+			case OperatorT::Add: return Left + Right;
+			case OperatorT::Subtract: return Left - Right;
+			case OperatorT::Multiply: return Left * Right;
+			case OperatorT::Divide: return Left / Right;
+			case OperatorT::Remainder: return std::fmod(Left, Right);
+			default: ERROR; return {};
+		}
+	}
+};
+
+// Computed unsigned so overflow wraps, like the generated instructions.  Operations the instructions leave 
+// undefined are errors.
+template <typename DataT> struct FoldArithmeticT<DataT, typename std::enable_if<std::is_integral<DataT>::value>::type>
+{
+	static DataT Fold(ContextT const &Context, OperatorT Operator, DataT Left, DataT Right)
+	{
+		auto const UnsignedLeft = static_cast<uint32_t>(Left), UnsignedRight = static_cast<uint32_t>(Right);
+		bool const Overflows = std::is_signed<DataT>::value && 
+			(Left == std::numeric_limits<DataT>::min()) && (Right == static_cast<DataT>(-1));
+		switch (Operator)
+		{
+			case OperatorT::Add: return static_cast<DataT>(UnsignedLeft + UnsignedRight);
+			case OperatorT::Subtract: return static_cast<DataT>(UnsignedLeft - UnsignedRight);
+			case OperatorT::Multiply: return static_cast<DataT>(UnsignedLeft * UnsignedRight);
+			case OperatorT::Divide:
+				if ((Right == 0) || Overflows) ERROR;
+				return Left / Right;
+			case OperatorT::Remainder:
+				if ((Right == 0) || Overflows) ERROR;
+				return Left % Right;
+			case OperatorT::And: return static_cast<DataT>(UnsignedLeft & UnsignedRight);
+			case OperatorT::Or: return static_cast<DataT>(UnsignedLeft | UnsignedRight);
+			case OperatorT::Xor: return static_cast<DataT>(UnsignedLeft ^ UnsignedRight);
+			case OperatorT::ShiftLeft:
+				if (UnsignedRight >= 32) ERROR;
+				return static_cast<DataT>(UnsignedLeft << UnsignedRight);
+			case OperatorT::ShiftRight:
+				if (UnsignedRight >= 32) ERROR;
+				return Left >> UnsignedRight;
+			default: assert(false); return {};
+		}
+	}
+};
+
+template <typename DataT> AtomT FoldBinaryOperation(
+	ContextT const &Context, OperatorT Operator, AtomT &Left, AtomT &Right, NumericTypeT *Type)
+{
+	DataT LeftData, RightData;
+	if (!ConstantOperand(Left, LeftData) || !ConstantOperand(Right, RightData)) ERROR;
+	if (IsComparison(Operator))
+	{
+		auto Out = new NumericT<int32_t>(Context.Position);
+		Out->Type = Type;
+		Out->Initialized = true;
+		Out->Data = FoldComparison(Operator, LeftData, RightData) ? 1 : 0;
+		return Out;
+	}
+	auto Out = new NumericT<DataT>(Context.Position);
+	Out->Type = Type;
+	Out->Initialized = true;
+	Out->Data = FoldArithmeticT<DataT>::Fold(Context, Operator, LeftData, RightData);
 	return Out;
 }
 
-void AsDynamicTypeT::Simplify(ContextT Context) 
+llvm::Value *GenerateLLVMBinaryOperation(
+	ContextT const &Context, OperatorT Operator, DataTypeT DataType, llvm::Value *Left, llvm::Value *Right)
 {
-	Type->Simplify(Context);
-	auto NewType = Type->Clone();
-	if (auto Numeric = NewType.As<NumericTypeT>())
+	auto Block = Context.Block;
+	bool const Real = (DataType == DataTypeT::Float) || (DataType == DataTypeT::Double);
+	bool const Signed = DataType == DataTypeT::Int;
+	auto Arithmetic = [&](llvm::Instruction::BinaryOps RealOperation, llvm::Instruction::BinaryOps IntegerOperation)
+		{ return llvm::BinaryOperator::Create(Real ? RealOperation : IntegerOperation, Left, Right, "", Block); };
+	auto Compare = [&](llvm::CmpInst::Predicate RealPredicate, llvm::CmpInst::Predicate SignedPredicate, 
+		llvm::CmpInst::Predicate UnsignedPredicate) -> llvm::Value *
 	{
-		Numeric->Constant = false;
-	}
-	else if (auto FunctionType = NewType.As<FunctionTypeT>())
+		llvm::Value *Compared = nullptr;
+		if (Real) Compared = new llvm::FCmpInst(*Block, RealPredicate, Left, Right);
+		else Compared = new llvm::ICmpInst(*Block, Signed ? SignedPredicate : UnsignedPredicate, Left, Right);
+		return new llvm::ZExtInst(Compared, llvm::IntegerType::get(Context.LLVM, 32), "", Block);
+	};
+	switch (Operator)
 	{
-		FunctionType->Constant = false;
+		case OperatorT::Add: return Arithmetic(llvm::Instruction::FAdd, llvm::Instruction::Add);
+		case OperatorT::Subtract: return Arithmetic(llvm::Instruction::FSub, llvm::Instruction::Sub);
+		case OperatorT::Multiply: return Arithmetic(llvm::Instruction::FMul, llvm::Instruction::Mul);
+		case OperatorT::Divide: 
+			return Arithmetic(llvm::Instruction::FDiv, Signed ? llvm::Instruction::SDiv : llvm::Instruction::UDiv);
+		case OperatorT::Remainder: 
+			return Arithmetic(llvm::Instruction::FRem, Signed ? llvm::Instruction::SRem : llvm::Instruction::URem);
+		case OperatorT::Equal: return Compare(llvm::CmpInst::FCMP_OEQ, llvm::CmpInst::ICMP_EQ, llvm::CmpInst::ICMP_EQ);
+		case OperatorT::NotEqual: return Compare(llvm::CmpInst::FCMP_UNE, llvm::CmpInst::ICMP_NE, llvm::CmpInst::ICMP_NE);
+		case OperatorT::Less: return Compare(llvm::CmpInst::FCMP_OLT, llvm::CmpInst::ICMP_SLT, llvm::CmpInst::ICMP_ULT);
+		case OperatorT::LessEqual: return Compare(llvm::CmpInst::FCMP_OLE, llvm::CmpInst::ICMP_SLE, llvm::CmpInst::ICMP_ULE);
+		case OperatorT::Greater: return Compare(llvm::CmpInst::FCMP_OGT, llvm::CmpInst::ICMP_SGT, llvm::CmpInst::ICMP_UGT);
+		case OperatorT::GreaterEqual: return Compare(llvm::CmpInst::FCMP_OGE, llvm::CmpInst::ICMP_SGE, llvm::CmpInst::ICMP_UGE);
+		case OperatorT::And: return Arithmetic(llvm::Instruction::And, llvm::Instruction::And);
+		case OperatorT::Or: return Arithmetic(llvm::Instruction::Or, llvm::Instruction::Or);
+		case OperatorT::Xor: return Arithmetic(llvm::Instruction::Xor, llvm::Instruction::Xor);
+		case OperatorT::ShiftLeft: return Arithmetic(llvm::Instruction::Shl, llvm::Instruction::Shl);
+		case OperatorT::ShiftRight: 
+			return Arithmetic(llvm::Instruction::AShr, Signed ? llvm::Instruction::AShr : llvm::Instruction::LShr);
 	}
-	else ERROR;
-	Replace(NewType);
+	assert(false);
+	return nullptr;
+}
 }
 
-//================================================================================================================
-// Statements
-AssignmentT::AssignmentT(PositionT const Position) : NucleusT(Position) {}
+BinaryOperationT::BinaryOperationT(PositionT const Position) : 
+	NucleusT(Position, KindT::BinaryOperation), Operator(OperatorT::Add) {}
 
-AtomT AssignmentT::Clone(void)
+AtomT BinaryOperationT::Clone(void)
 {
-	auto Out = new AssignmentT(Position);
-	Out->Left = Left->Clone();
-	Out->Right = Right->Clone();
+	auto Out = new BinaryOperationT(Position);
+	Out->Operator = Operator;
+	Out->Left = CloneNode(Left);
+	Out->Right = CloneNode(Right);
 	return Out;
 }
 
-void AssignmentT::Simplify(ContextT Context)
+void BinaryOperationT::Trace(VisitT const &Visit)
 {
-	Context.Position = Position;
-	Left->Simplify(Context);
-	Right->Simplify(Context);
-	auto Assignable = Left.As<AssignableT>();
-	if (!Assignable) ERROR;
-	Assignable->Assign(Context, Right);
+	NucleusT::Trace(Visit);
+	Visit(Left);
+	Visit(Right);
+}
+
+void BinaryOperationT::Schedule(SimplifyEngineT &Engine, ContextT const &OuterContext)
+{
+	auto Context = OuterContext.WithPosition(Position);
+	Engine.Simplify(Context, this);
+	Engine.Schedule(Context, Right);
+	Engine.Schedule(Context, Left);
+}
+
+void BinaryOperationT::Simplify(ContextT const &Context)
+{
+	auto LeftType = Left->GetType(Context).As<NumericTypeT>();
+	auto RightType = Right->GetType(Context).As<NumericTypeT>();
+	if (!LeftType || !RightType) ERROR;
+	if (LeftType->ID != RightType->ID) ERROR;
+	auto const DataType = PromoteDataType(LeftType->DataType, RightType->DataType);
+	if (IsBitwise(Operator) && (DataType != DataTypeT::Int) && (DataType != DataTypeT::UInt)) ERROR;
+	
+	auto const Comparison = IsComparison(Operator);
+	auto MakeType = [&](bool Constant) -> NumericTypeT *
+	{
+		auto const ID = Comparison ? DefaultTypeID : LeftType->ID;
+		auto const ResultDataType = Comparison ? DataTypeT::Int : DataType;
+		if (Context.Types) return Context.Types->Numeric(Position, ID, Constant, false, ResultDataType);
+		auto Type = new NumericTypeT(Position);
+		Type->ID = ID;
+		Type->Constant = Constant;
+		Type->Static = false;
+		Type->DataType = ResultDataType;
+		return Type;
+	};
+	
+	if (LeftType->Constant && RightType->Constant)
+	{
+		auto Type = MakeType(true);
+		switch (DataType)
+		{
+			case DataTypeT::Int: Replace(FoldBinaryOperation<int32_t>(Context, Operator, Left, Right, Type)); break;
+			case DataTypeT::UInt: Replace(FoldBinaryOperation<uint32_t>(Context, Operator, Left, Right, Type)); break;
+			case DataTypeT::Float: Replace(FoldBinaryOperation<float>(Context, Operator, Left, Right, Type)); break;
+			case DataTypeT::Double: Replace(FoldBinaryOperation<double>(Context, Operator, Left, Right, Type)); break;
+		}
+		return;
+	}
+	
+	auto OperandType = GenerateLLVMNumericType(Context, DataType);
+	auto Load = [&](AtomT &Operand, NumericTypeT *Type) -> llvm::Value *
+	{
+		auto Loadable = Operand.As<LLVMLoadableT>();
+		if (!Loadable) ERROR;
+		return GenerateLLVMNumericConversion(
+			Context.Block,
+			Loadable->GenerateLLVMLoad(Context),
+			Type->GenerateLLVMType(Context),
+			Type->IsSigned(),
+			OperandType,
+			DataType == DataTypeT::Int);
+	};
+	auto LeftValue = Load(Left, *LeftType);
+	auto RightValue = Load(Right, *RightType);
+	auto Result = GenerateLLVMBinaryOperation(Context, Operator, DataType, LeftValue, RightValue);
+	
+	auto Type = MakeType(false);
+	auto Out = new DynamicT(Context.Position);
+	Out->Type = Type;
+	Out->Target = new llvm::AllocaInst(Type->GenerateLLVMType(Context), "", Context.Block);
+	new llvm::StoreInst(Result, Out->Target, Context.Block);
+	Out->Initialized = true;
+	Replace(Out);
 }
 
 //================================================================================================================
 // Functions
 
-FunctionTypeT::FunctionTypeT(PositionT const Position) : NucleusT(Position), ID(0), Constant(true), Static(true) {}
+FunctionTypeT::FunctionTypeT(PositionT const Position) : NucleusT(Position, KindT::FunctionType), ID(0), Constant(true), Static(true) {}
 
 AtomT FunctionTypeT::Clone(void)
 {
@@ -718,16 +1805,28 @@ AtomT FunctionTypeT::Clone(void)
 	Out->ID = ID;
 	Out->Constant = Constant;
 	Out->Static = Static;
-	Out->Signature = Signature->Clone();
+	Out->Signature = CloneNode(Signature);
 	return Out;
 }
 
-void FunctionTypeT::Simplify(ContextT Context)
+void FunctionTypeT::Trace(VisitT const &Visit)
 {
-	Signature->Simplify(Context);
+	NucleusT::Trace(Visit);
+	Visit(Signature);
 }
 
-AtomT FunctionTypeT::Allocate(ContextT Context, AtomT Value) 
+void FunctionTypeT::Schedule(SimplifyEngineT &Engine, ContextT const &Context)
+{
+	Engine.Simplify(Context, this);
+	Engine.Schedule(Context, Signature);
+}
+
+void FunctionTypeT::Simplify(ContextT const &Context)
+{
+	if (Context.Types) Replace(Context.Types->Intern(this));
+}
+
+AtomT FunctionTypeT::Allocate(ContextT const &Context, AtomT Value) 
 {
 	auto Function = new FunctionT(Context.Position);
 	Function->Type = this;
@@ -751,21 +1850,22 @@ bool FunctionTypeT::IsDynamic(void)
 	return !Constant;
 }
 
-void FunctionTypeT::CheckType(ContextT Context, AtomT Other)
+void FunctionTypeT::CheckType(ContextT const &Context, AtomT Other)
 {
 	AssertNE(ID, 0);
 	auto OtherType = Other->GetType(Context).As<FunctionTypeT>();
 	if (!OtherType) ERROR;
+	if (*OtherType == this) return;
 	if (OtherType->ID != ID) ERROR;
 }
 
-llvm::Type *FunctionTypeT::GenerateLLVMType(ContextT Context)
+llvm::Type *FunctionTypeT::GenerateLLVMType(ContextT const &Context)
 {
 	auto Result = ProcessFunction(Context, GenerateLLVMTypeParamsT{});
 	return Result.Get<GenerateLLVMTypeResultsT>().Type;
 }
 	
-void FunctionTypeT::AssignLLVM(ContextT Context, bool &Initialized, llvm::Value *Target, AtomT Other)
+void FunctionTypeT::AssignLLVM(ContextT const &Context, bool &Initialized, llvm::Value *Target, AtomT Other)
 {
 	CheckType(Context, Other);
 	if (Initialized && Static) ERROR;
@@ -782,7 +1882,7 @@ void FunctionTypeT::AssignLLVM(ContextT Context, bool &Initialized, llvm::Value
 	Initialized = true;
 }
 
-AtomT FunctionTypeT::Call(ContextT Context, AtomT Function, AtomT Input)
+AtomT FunctionTypeT::Call(ContextT const &Context, AtomT Function, AtomT Input)
 {
 	auto Result = ProcessFunction(Context, CallParamsT{Function, Input});
 	return Result.Get<CallResultsT>().Result;
@@ -798,65 +1898,79 @@ std::vector<uint8_t> GetLLVMArgID(ExplicitT<GroupT>)
 	return {1};
 }
 
+template <typename DataT> std::vector<uint8_t> GetLLVMArgID(uint8_t Tag, NumericT<DataT> const &Number)
+{
+	std::vector<uint8_t> Out;
+	Out.resize(1 + sizeof(Number.Data));
+	Out[0] = Tag;
+	std::memcpy(&Out[1], &Number.Data, sizeof(Number.Data));
+	return Out;
+}
+
 std::vector<uint8_t> GetLLVMArgID(AtomT const &Value)
 {
-	if (auto Dynamic = Value.As<DynamicT>())
-	{
-		return GetLLVMArgID(ExplicitT<DynamicT>());
-	}
-	else if (auto Group = Value.As<GroupT>())
-	{
-		return GetLLVMArgID(ExplicitT<GroupT>());
-	}
-	else if (auto String = Value.As<StringT>())
-	{
-		std::vector<uint8_t> Out;
-		Out.resize(1 + String->Data.size());
-		Out[0] = 2;
-		std::copy(String->Data.begin(), String->Data.end(), Out.begin() + 1);
-		return Out;
-	}
-	else if (auto Number = Value.As<NumericT<int32_t>>())
-	{
-		std::vector<uint8_t> Out;
-		Out.resize(1 + sizeof(Number->Data));
-		Out[0] = 3;
-		*reinterpret_cast<decltype(Number->Data) *>(&Out[1]) = Number->Data;
-		return Out;
-	}
-	else if (auto Number = Value.As<NumericT<uint32_t>>())
+	switch (Value.Kind())
 	{
-		std::vector<uint8_t> Out;
-		Out.resize(1 + sizeof(Number->Data));
-		Out[0] = 4;
-		*reinterpret_cast<decltype(Number->Data) *>(&Out[1]) = Number->Data;
-		return Out;
+		case KindT::Dynamic: return GetLLVMArgID(ExplicitT<DynamicT>());
+		case KindT::Group: return GetLLVMArgID(ExplicitT<GroupT>());
+		case KindT::String:
+		{
+			SymbolT const Symbol((*Value.As<StringT>())->Data);
+			std::vector<uint8_t> Out;
+			Out.resize(1 + sizeof(Symbol.ID));
+			Out[0] = 2;
+			std::memcpy(&Out[1], &Symbol.ID, sizeof(Symbol.ID));
+			return Out;
+		}
+		case KindT::Int: return GetLLVMArgID(3, **Value.As<NumericT<int32_t>>());
+		case KindT::UInt: return GetLLVMArgID(4, **Value.As<NumericT<uint32_t>>());
+		case KindT::Float: return GetLLVMArgID(5, **Value.As<NumericT<float>>());
+		case KindT::Double: return GetLLVMArgID(6, **Value.As<NumericT<double>>());
+		default: assert(false);
 	}
-	else if (auto Number = Value.As<NumericT<float>>())
+	return {};
+}
+
+// Memoized constant results are copied out so callers can't modify them
+AtomT CopyConstant(ContextT const &Context, AtomT &Value)
+{
+	switch (Value.Kind())
 	{
-		std::vector<uint8_t> Out;
-		Out.resize(1 + sizeof(Number->Data));
-		Out[0] = 5;
-		*reinterpret_cast<decltype(Number->Data) *>(&Out[1]) = Number->Data;
-		return Out;
+		case KindT::Function: return Value;
+		case KindT::Group:
+		{
+			auto Out = new GroupT(Context.Position);
+			for (auto &Pair : **Value.As<GroupT>())
+				Out->Add(Pair.first, CopyConstant(Context, Pair.second));
+			return Out;
+		}
+		case KindT::Undefined: 
+		case KindT::Dynamic: 
+		case KindT::Module: ERROR;
+		default: return CloneNode(Value);
 	}
-	else if (auto Number = Value.As<NumericT<double>>())
+}
+
+// Values from a constant evaluation's scratch function are gone once it's erased
+static bool HasDynamic(AtomT &Value)
+{
+	std::vector<NucleusT *> Pending{Value};
+	while (!Pending.empty())
 	{
-		std::vector<uint8_t> Out;
-		Out.resize(1 + sizeof(Number->Data));
-		Out[0] = 6;
-		*reinterpret_cast<decltype(Number->Data) *>(&Out[1]) = Number->Data;
-		return Out;
+		auto Nucleus = Pending.back();
+		Pending.pop_back();
+		if (!Nucleus) continue;
+		if (Nucleus->Kind == KindT::Dynamic) return true;
+		if (Nucleus->Kind == KindT::Group)
+			for (auto &Pair : *static_cast<GroupT *>(Nucleus)) Pending.push_back(Pair.second);
 	}
-	else assert(false);
-	return {};
+	return false;
 }
 
-constexpr auto FunctionInputKey = "input";
-constexpr auto FunctionOutputKey = "output";
-FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Context, ProcessFunctionParamT Param)
+FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT const &Context, ProcessFunctionParamT Param)
 {
 	FunctionTreeT<FunctionT::CachedLLVMFunctionT> *FunctionTree = nullptr;
+	AtomT Owner; // With Body, kept alive by the continuation of a deferred body (the instance tree is the owner's)
 	AtomT CallInput;
 	
 	AtomT Body;
@@ -871,22 +1985,30 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 	else if (Param.Is<GenerateLLVMLoadParamsT>())
 	{
 		auto &Params = Param.Get<GenerateLLVMLoadParamsT>();
+		Owner = Params.Function;
 		Body = Params.Function->Body;
 		FunctionTree = &Params.Function->InstanceTree;
 	}
 	else if (Param.Is<CallParamsT>())
 	{
 		auto &Params = Param.Get<CallParamsT>();
-		if (auto Function = Params.Function.As<FunctionT>())
-		{
-			Body = Function->Body;
-			FunctionTree = &Function->InstanceTree;
-		}
-		else if (auto Dynamic = Params.Function.As<DynamicT>())
+		switch (Params.Function.Kind())
 		{
-			LLVMFunction = Dynamic->GenerateLLVMLoad(Context);
+			case KindT::Function:
+			{
+				auto Function = *Params.Function.As<FunctionT>();
+				Owner = Function;
+				Body = Function->Body;
+				FunctionTree = &Function->InstanceTree;
+				break;
+			}
+			case KindT::Dynamic:
+			{
+				LLVMFunction = (*Params.Function.As<DynamicT>())->GenerateLLVMLoad(Context);
+				break;
+			}
+			default: ERROR;
 		}
-		else ERROR;
 		CallInput = Params.Input;
 	}
 	else assert(false);
@@ -895,11 +2017,71 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 	OptionalT<FunctionTreeT<FunctionT::CachedLLVMFunctionT>::LookupT> FunctionLookup;
 	if (FunctionTree) FunctionLookup = FunctionTree->StartLookup();
 	
-	auto FunctionContext = Context;
-	FunctionContext.IsConstant = true;
+	auto FunctionContext = Context.WithConstant(true);
+	
+	auto Signature = this->Signature.As<GroupT>();
+	if (!Signature) ERROR;
+	auto InputType = Signature->GetByKey(SymbolT::Input());
+	auto OutputType = Signature->GetByKey(SymbolT::Output());
+	
+	// Find the specialization up front, so the body is only cloned when a new one has to be compiled
+	if (InputType)
+	{
+		FingerprintT Specialization;
+		Specialization.Mix(ID);
+		auto Enter = [&](std::vector<uint8_t> const &Key)
+		{
+			Specialization.Mix(Key.size());
+			Specialization.Mix(Key.data(), Key.size());
+			TypeLookup.Enter(Key);
+			if (FunctionLookup)
+				FunctionLookup->Enter(Key);
+		};
+		std::function<void(AtomT Type, AtomT Call)> EnterInput;
+		EnterInput = [&](AtomT Type, AtomT Call)
+		{
+			if (Param.Is<CallParamsT>())
+				Enter(GetLLVMArgID(Call));
+			
+			if (auto Group = Type.As<GroupT>())
+			{
+				OptionalT<GroupT *> CallGroup;
+				if (Param.Is<CallParamsT>())
+				{
+					auto OptCallGroup = Call.As<GroupT>();
+					if (!OptCallGroup) ERROR;
+					CallGroup = *OptCallGroup;
+				}
+				else Enter(GetLLVMArgID(ExplicitT<GroupT>()));
+				
+				for (auto &TypePair : **Group)
+				{
+					AtomT SubCall;
+					if (Param.Is<CallParamsT>())
+					{
+						auto OptSubCall = (*CallGroup)->GetByKey(TypePair.first);
+						if (!OptSubCall) ERROR;
+						SubCall = *OptSubCall;
+					}
+					EnterInput(TypePair.second, SubCall);
+				}
+			}
+			else if (auto SimpleType = Type.As<TypeT>())
+			{
+				if (!Param.Is<CallParamsT>() && SimpleType->IsDynamic())
+					Enter(GetLLVMArgID(ExplicitT<DynamicT>()));
+			}
+			else ERROR;
+		};
+		EnterInput(*InputType, CallInput);
+		if (Context.Dependencies && Param.Is<CallParamsT>()) 
+			Context.Dependencies->Specializations.push_back(Specialization.Hash);
+	}
 	
 	OptionalT<BlockT *> BlockBody;
 	OptionalT<GroupT *> BodyGroup;
+	if (Body && FunctionLookup && *FunctionLookup && (Param.Is<CallParamsT>() || (*FunctionLookup)->Function)) 
+		Body.Clear();
 	if (Body)
 	{
 		BlockBody = Body.As<BlockT>();
@@ -908,11 +2090,6 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 		BodyGroup = Body.As<GroupT>();
 		Assert(*BodyGroup);
 	}
-	
-	auto Signature = this->Signature.As<GroupT>();
-	if (!Signature) ERROR;
-	auto InputType = Signature->GetByKey(FunctionInputKey);
-	auto OutputType = Signature->GetByKey(FunctionOutputKey);
 
 	std::vector<llvm::Type *> LLVMArgTypes;
 	std::vector<llvm::Type *> LLVMReturnTypes;
@@ -932,11 +2109,15 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 	AtomT BodyOutput;
 	if (Body) 
 	{
-		BodyInput = (*BodyGroup)->AccessElement(Context, FunctionInputKey);
-		BodyOutput = (*BodyGroup)->AccessElement(Context, FunctionOutputKey);
+		BodyInput = (*BodyGroup)->AccessElement(Context, SymbolT::Input());
+		BodyOutput = (*BodyGroup)->AccessElement(Context, SymbolT::Output());
 	}
 	std::vector<DynamicT *> DynamicBodyOutput;
 	std::vector<DynamicT *> DynamicBodyInput;
+	std::vector<AtomT> ConstantOutputs; // Shared by body and call, memoized for calls that reuse the compiled body
+	OptionalT<std::vector<AtomT> *> MemoizedConstantOutputs;
+	if (!Body && FunctionLookup && *FunctionLookup && (*FunctionLookup)->Function) 
+		MemoizedConstantOutputs = &(*FunctionLookup)->ConstantOutputs;
 	
 	if (OutputType)
 	{
@@ -1011,10 +2192,18 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 				{
 					if (Param.Is<GenerateLLVMTypeParamsT>() || Param.Is<GenerateLLVMLoadParamsT>())
 						ERROR;
-					Assert(Body);
 					Assert(Param.Is<CallParamsT>());
-					auto ConstantOutput = SimpleType->Allocate(Context, {});
-					BodyAssignable->Assign(Context, ConstantOutput);
+					AtomT ConstantOutput;
+					if (MemoizedConstantOutputs)
+					{
+						// Still compiling (a recursive call), so the values aren't known yet
+						if (ConstantOutputs.size() >= (*MemoizedConstantOutputs)->size()) ERROR;
+						ConstantOutput = CopyConstant(Context, (**MemoizedConstantOutputs)[ConstantOutputs.size()]);
+					}
+					else ConstantOutput = SimpleType->Allocate(Context, {});
+					ConstantOutputs.push_back(ConstantOutput);
+					if (Body)
+						BodyAssignable->Assign(Context, ConstantOutput);
 					CallAssignable->Assign(Context, ConstantOutput);
 				}
 			}
@@ -1022,12 +2211,7 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 		};
 		ClassifyOutput(*OutputType, BodyOutput, CallOutput);
 		
-		if (LLVMReturnTypes.size() == 1)
-		{
-			Assert(DynamicBodyOutput.size() == 1);
-			DynamicBodyOutput[0]->Target = new llvm::AllocaInst(LLVMReturnTypes[0], "", Context.Block);
-		}
-		else if (LLVMReturnTypes.size() > 1)
+		if (LLVMReturnTypes.size() > 1)
 		{
 			if (TypeLookup) 
 			{
@@ -1057,13 +2241,6 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 		std::function<void(AtomT Type, AtomT Call, AtomT Body)> ClassifyInput;
 		ClassifyInput = [&](AtomT Type, AtomT Call, AtomT Body)
 		{
-			if (Param.Is<CallParamsT>())
-			{
-				TypeLookup.Enter(GetLLVMArgID(Call));
-				if (FunctionLookup)
-					FunctionLookup->Enter(GetLLVMArgID(Call));
-			}
-			
 			OptionalT<AssignableT *> BodyAssignable;
 			if (Body)
 			{
@@ -1081,12 +2258,6 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 					if (!OptCallGroup) ERROR;
 					CallGroup = *OptCallGroup;
 				}
-				else
-				{
-					TypeLookup.Enter(GetLLVMArgID(ExplicitT<GroupT>()));
-					if (FunctionLookup)
-						FunctionLookup->Enter(GetLLVMArgID(ExplicitT<GroupT>()));
-				}
 				
 				OptionalT<GroupT *> BodyGroup;
 				if (Body)
@@ -1137,12 +2308,6 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 						if (!CallValue) ERROR;
 						DynamicCallInput.push_back(CallValue->GenerateLLVMLoad(Context));
 					}
-					else
-					{
-						TypeLookup.Enter(GetLLVMArgID(ExplicitT<DynamicT>()));
-						if (FunctionLookup)
-							FunctionLookup->Enter(GetLLVMArgID(ExplicitT<DynamicT>()));
-					}
 					
 					if (Body)
 					{
@@ -1155,12 +2320,15 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 				{
 					if (Param.Is<GenerateLLVMTypeParamsT>() || Param.Is<GenerateLLVMLoadParamsT>())
 						ERROR;
-					Assert(Body);
 					Assert(Param.Is<CallParamsT>());
-					auto BodyAtom = SimpleType->Allocate(Context, {});
-					auto BodyValue = BodyAtom.As<AssignableT>();
-					BodyValue->Assign(Context, Call);
-					BodyAssignable->Assign(Context, BodyAtom);
+					// Constant inputs are part of the specialization key, so a compiled one doesn't need them
+					if (Body)
+					{
+						auto BodyAtom = SimpleType->Allocate(Context, {});
+						auto BodyValue = BodyAtom.As<AssignableT>();
+						BodyValue->Assign(Context, Call);
+						BodyAssignable->Assign(Context, BodyAtom);
+					}
 				}
 			}
 			else ERROR;
@@ -1187,11 +2355,55 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 	
 	if (Param.Is<GenerateLLVMTypeParamsT>()) return GenerateLLVMTypeResultsT{LLVMFunctionType}; // NOTE Return
 	
+	// Constant calls are evaluated rather than compiled.  Anything the body still generates (like dynamic locals) 
+	// goes to a scratch function that's erased, since nothing outside can observe it.
+	// Bodies are simplified on the running engine, ahead of the caller's remaining tasks; the result is complete 
+	// by the time anything else can read it.  What needs the finished body happens in a continuation.
+	if (Param.Is<CallParamsT>() && FunctionLookup && FunctionContext.IsConstant)
+	{
+		auto &Instance = **FunctionLookup;
+		if (Body)
+		{
+			Instance.Evaluating = true;
+			if (Context.Budget) ++Context.Budget->Evaluated;
+			// Shared with the continuation, so the budget is released even if the engine is unwound before it runs
+			auto BudgetScope = std::make_shared<EvaluationBudgetT::ScopeT>(Context.Budget);
+			auto Scratch = llvm::Function::Create(
+				llvm::FunctionType::get(llvm::Type::getVoidTy(Context.LLVM), false), 
+				llvm::Function::InternalLinkage, 
+				"", 
+				Context.Module);
+			auto ScratchBlock = llvm::BasicBlock::Create(Context.LLVM, "", Scratch);
+			auto InstancePointer = &Instance;
+			bool const Memoize = OutputType;
+			SimplifyEngineT::Nest([&](SimplifyEngineT &Engine)
+			{
+				Engine.Continue(Context, [=](void) mutable
+				{
+					if (HasDynamic(CallOutput)) ERROR;
+					Scratch->dropAllReferences();
+					if (Scratch->getParent()) Scratch->eraseFromParent();
+					else delete Scratch;
+					BudgetScope.reset();
+					InstancePointer->Evaluating = false;
+					if (Memoize) InstancePointer->Output = CopyConstant(Context, CallOutput);
+					Owner.Clear();
+					Body.Clear();
+				});
+				Engine.Schedule(FunctionContext.WithBlock(ScratchBlock), *BodyGroup);
+			});
+			return CallResultsT{CallOutput}; // NOTE Return
+		}
+		if (Instance.Evaluating) ERROR; // Recursed with the same arguments, so it would never finish
+		if (Instance.Output) return CallResultsT{CopyConstant(Context, Instance.Output)}; // NOTE Return
+		return CallResultsT{CallOutput}; // NOTE Return
+	}
+	
 	if (LLVMFunction)
 	{
 		// NOP
 	}
-	else if (FunctionLookup && *FunctionLookup)
+	else if (FunctionLookup && *FunctionLookup && (*FunctionLookup)->Function)
 	{
 		LLVMFunction = (*FunctionLookup)->Function;
 		FunctionContext.IsConstant = (*FunctionLookup)->IsConstant;
@@ -1212,6 +2424,11 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 		(*FunctionLookup)->IsConstant = FunctionContext.IsConstant;
 		
 		auto Block = llvm::BasicBlock::Create(Context.LLVM, "entrypoint", SpecificLLVMFunction);
+		if (LLVMReturnTypes.size() == 1)
+		{
+			AssertE(DynamicBodyOutput.size(), 1u);
+			DynamicBodyOutput[0]->Target = new llvm::AllocaInst(LLVMReturnTypes[0], "", Block);
+		}
 		
 		{
 			size_t Index = 0, InputIndex = 0;
@@ -1235,18 +2452,33 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 		}
 		
 		FunctionContext.Block = Block;
-		(*BodyGroup)->Simplify(FunctionContext);
-		
-		if (LLVMReturnTypes.size() == 1)
-			llvm::ReturnInst::Create(Context.LLVM, DynamicBodyOutput[0]->GenerateLLVMLoad(Context), Block);
-		else llvm::ReturnInst::Create(Context.LLVM, Block);
+		auto Instance = &**FunctionLookup;
+		AtomT Result;
+		if (LLVMReturnTypes.size() == 1) Result = DynamicBodyOutput[0];
+		SimplifyEngineT::Nest([&](SimplifyEngineT &Engine)
+		{
+			Engine.Continue(FunctionContext, [=](void) mutable
+			{
+				for (auto &Output : ConstantOutputs)
+					Instance->ConstantOutputs.push_back(CopyConstant(FunctionContext, Output));
+				
+				if (Result)
+				{
+					auto Value = (*Result.As<DynamicT>())->GenerateLLVMLoad(FunctionContext);
+					llvm::ReturnInst::Create(FunctionContext.LLVM, Value, Block);
+				}
+				else llvm::ReturnInst::Create(FunctionContext.LLVM, Block);
+				Owner.Clear();
+				Body.Clear();
+			});
+			Engine.Schedule(FunctionContext, *BodyGroup);
+		});
 	}
 
 	if (Param.Is<GenerateLLVMLoadParamsT>()) return GenerateLLVMLoadResultsT{LLVMFunction}; // NOTE Return
 	
 	if (!FunctionContext.IsConstant)
 	{
-		Context.IsConstant = false;
 		auto Result = llvm::CallInst::Create(LLVMFunction, DynamicCallInput, "", Context.Block);
 		
 		if (LLVMReturnTypes.size() == 1)
@@ -1256,73 +2488,328 @@ FunctionTypeT::ProcessFunctionResultT FunctionTypeT::ProcessFunction(ContextT Co
 		}
 	}
 	
-	return CallResultsT{BodyOutput}; // NOTE Return
+	return CallResultsT{CallOutput}; // NOTE Return
 }
 
-FunctionT::FunctionT(PositionT const Position) : NucleusT(Position) {}
-
-AtomT FunctionT::GetType(ContextT Context) { return Type; }
+FunctionT::FunctionT(PositionT const Position) : NucleusT(Position, KindT::Function) {}
 
-void FunctionT::Simplify(ContextT Context)
+void FunctionT::Trace(VisitT const &Visit)
 {
-	Type->Simplify(Context);
+	NucleusT::Trace(Visit);
+	Visit(Type);
+	Visit(Body);
+	std::function<void(FunctionTreeT<CachedLLVMFunctionT>::ElementT &Element)> TraceInstances;
+	TraceInstances = [&](FunctionTreeT<CachedLLVMFunctionT>::ElementT &Element)
+	{
+		if (Element.Leaf)
+		{
+			for (auto &Output : Element.Leaf->ConstantOutputs) Visit(Output);
+			Visit(Element.Leaf->Output);
+		}
+		for (auto &Branch : Element.Branches) TraceInstances(*Branch.second);
+	};
+	TraceInstances(InstanceTree.Root);
 }
 
-AtomT FunctionT::Call(ContextT Context, AtomT Input)
+AtomT FunctionT::GetType(ContextT const &Context) { return Type; }
+
+void FunctionT::Schedule(SimplifyEngineT &Engine, ContextT const &Context) { Engine.Schedule(Context, Type); }
+
+AtomT FunctionT::Call(ContextT const &Context, AtomT Input)
 {
 	return GetType(Context).As<FunctionTypeT>()->Call(Context, Body, Input);
 }
 
-CallT::CallT(PositionT const Position) : NucleusT(Position) { }
+CallT::CallT(PositionT const Position) : NucleusT(Position, KindT::Call) { }
 
 AtomT CallT::Clone(void)
 {
 	auto Out = new CallT(Position);
-	Out->Function = Function->Clone();
+	Out->Function = CloneNode(Function);
 	if (Input) 
-		Out->Input = Input->Clone();
+		Out->Input = CloneNode(Input);
 	return Out;
 }
 
-void CallT::Simplify(ContextT Context)
+void CallT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Function);
+	Visit(Input);
+}
+
+void CallT::Schedule(SimplifyEngineT &Engine, ContextT const &Context)
+{
+	Engine.Simplify(Context, this);
+	Engine.Schedule(Context, Input);
+	Engine.Schedule(Context, Function);
+}
+
+void CallT::Simplify(ContextT const &Context)
 {
-	Function->Simplify(Context);
-	Input->Simplify(Context);
 	AtomT Type;
-	if (auto Function = this->Function.As<FunctionT>())
-		Type = Function->GetType(Context);
-	else if (auto Dynamic = this->Function.As<DynamicT>())
+	switch (this->Function.Kind())
 	{
-		if (auto FunctionType = Dynamic->Type.As<FunctionTypeT>())
-			Type = *FunctionType;
-		else ERROR;
+		case KindT::Function: Type = (*this->Function.As<FunctionT>())->GetType(Context); break;
+		case KindT::Dynamic:
+		{
+			auto &DynamicType = (*this->Function.As<DynamicT>())->Type;
+			if (!DynamicType.As<FunctionTypeT>()) ERROR;
+			Type = DynamicType;
+			break;
+		}
+		default: ERROR;
 	}
-	else ERROR;
 	auto FunctionType = Type.As<FunctionTypeT>();
 	if (!FunctionType) ERROR;
 	Replace(FunctionType->Call(Context, Function, Input));
 }
 
-ModuleT::ModuleT(PositionT const Position) : NucleusT(Position), Entry(false) {}
+//================================================================================================================
+// Type interning
+static uint64_t NumericTypeKey(uint16_t ID, bool Constant, bool Static, NumericTypeT::DataTypeT DataType)
+	{ return ((uint64_t)ID << 16) | ((uint64_t)DataType << 2) | ((uint64_t)Constant << 1) | Static; }
+
+static uint64_t StringTypeKey(uint16_t ID, bool Static) { return ((uint64_t)ID << 1) | Static; }
+
+NucleusT *TypeInternerT::Intern(NucleusT *Type)
+{
+	auto Register = [](std::unordered_map<uint64_t, AtomT> &Table, uint64_t Key, NucleusT *Type) -> NucleusT *
+	{
+		auto Found = Table.find(Key);
+		if (Found != Table.end()) return Found->second;
+		Table.emplace(Key, Type);
+		return Type;
+	};
+	switch (Type->Kind)
+	{
+		case KindT::NumericType:
+		{
+			auto Numeric = static_cast<NumericTypeT *>(Type);
+			auto Out = Register(Numerics, NumericTypeKey(Numeric->ID, Numeric->Constant, Numeric->Static, Numeric->DataType), Type);
+			if (Out == Type) Numeric->Interned = true;
+			return Out;
+		}
+		case KindT::StringType:
+		{
+			auto String = static_cast<StringTypeT *>(Type);
+			auto Out = Register(Strings, StringTypeKey(String->ID, String->Static), Type);
+			if (Out == Type) String->Interned = true;
+			return Out;
+		}
+		case KindT::FunctionType:
+		{
+			auto Function = static_cast<FunctionTypeT *>(Type);
+			if (Function->ID == 0) return Type; // Anonymous, nothing to compare by
+			return Register(Functions, ((uint64_t)Function->ID << 2) | ((uint64_t)Function->Constant << 1) | Function->Static, Type);
+		}
+		default: return Type;
+	}
+}
+
+NumericTypeT *TypeInternerT::Numeric(PositionT const Position, uint16_t ID, bool Constant, bool Static, NumericTypeT::DataTypeT DataType)
+{
+	auto &Slot = Numerics[NumericTypeKey(ID, Constant, Static, DataType)];
+	if (!Slot)
+	{
+		auto Type = new NumericTypeT(Position);
+		Type->ID = ID;
+		Type->Constant = Constant;
+		Type->Static = Static;
+		Type->DataType = DataType;
+		Type->Interned = true;
+		Slot = Type;
+	}
+	return *Slot.As<NumericTypeT>();
+}
+
+StringTypeT *TypeInternerT::String(PositionT const Position, uint16_t ID, bool Static)
+{
+	auto &Slot = Strings[StringTypeKey(ID, Static)];
+	if (!Slot)
+	{
+		auto Type = new StringTypeT(Position);
+		Type->ID = ID;
+		Type->Static = Static;
+		Type->Interned = true;
+		Slot = Type;
+	}
+	return *Slot.As<StringTypeT>();
+}
+
+//================================================================================================================
+// Dependency tracking
+StatementDependenciesT::StatementDependenciesT(GroupT *Top) : Top(Top), Emitted(false) {}
+
+void StatementDependenciesT::Access(SymbolT const Key, NucleusT *Before)
+{
+	if (!Seen.insert(Key.ID).second) return;
+	Accesses.push_back(AccessT{Key, Before, Before ? Contents(Before) : 0});
+}
+
+StatementCacheT::~StatementCacheT(void) {}
+
+uint64_t Fingerprint(AtomT &Node)
+{
+	// Preorder, with a marker for each missing child so different shapes can't hash the same
+	uint8_t const Missing = 0xFF;
+	FingerprintT Out;
+	std::vector<NucleusT *> Pending{Node};
+	while (!Pending.empty())
+	{
+		auto Nucleus = Pending.back();
+		Pending.pop_back();
+		if (!Nucleus) 
+		{
+			Out.Mix(Missing);
+			continue;
+		}
+		Out.Mix(Nucleus->Kind);
+		switch (Nucleus->Kind)
+		{
+			case KindT::String:
+			{
+				auto String = static_cast<StringT *>(Nucleus);
+				Out.Mix(String->Initialized);
+				Out.Mix(String->Data);
+				break;
+			}
+			case KindT::StringType:
+			{
+				auto Type = static_cast<StringTypeT *>(Nucleus);
+				Out.Mix(Type->ID);
+				Out.Mix(Type->Static);
+				break;
+			}
+#define FINGERPRINTNUMERIC(Name, DataT) \
+			case KindT::Name: \
+			{ \
+				auto Number = static_cast<NumericT<DataT> *>(Nucleus); \
+				Out.Mix(Number->Initialized); \
+				Out.Mix(Number->Data); \
+				break; \
+			}
+			FINGERPRINTNUMERIC(Int, int32_t)
+			FINGERPRINTNUMERIC(UInt, uint32_t)
+			FINGERPRINTNUMERIC(Float, float)
+			FINGERPRINTNUMERIC(Double, double)
+#undef FINGERPRINTNUMERIC
+			case KindT::NumericType:
+			{
+				auto Type = static_cast<NumericTypeT *>(Nucleus);
+				Out.Mix(Type->ID);
+				Out.Mix(Type->Constant);
+				Out.Mix(Type->Static);
+				Out.Mix(Type->DataType);
+				break;
+			}
+			case KindT::Group: Out.Mix(static_cast<GroupT *>(Nucleus)->Statements.size()); break;
+			case KindT::Block: Out.Mix(static_cast<BlockT *>(Nucleus)->Statements.size()); break;
+			case KindT::Element: Out.Mix(static_cast<ElementT *>(Nucleus)->Name.Name()); break; // Ids vary by run
+			case KindT::BinaryOperation: Out.Mix(static_cast<BinaryOperationT *>(Nucleus)->Operator); break;
+			case KindT::FunctionType:
+			{
+				auto Type = static_cast<FunctionTypeT *>(Nucleus);
+				Out.Mix(Type->ID);
+				Out.Mix(Type->Constant);
+				Out.Mix(Type->Static);
+				break;
+			}
+			default: break;
+		}
+		auto const First = Pending.size();
+		Nucleus->Trace([&Pending](AtomT &Child) { Pending.push_back(Child); });
+		std::reverse(Pending.begin() + First, Pending.end());
+	}
+	return Out.Hash;
+}
+
+uint64_t Contents(NucleusT *Value)
+{
+	FingerprintT Out;
+	std::unordered_set<NucleusT *> Visited;
+	std::vector<NucleusT *> Pending{Value};
+	while (!Pending.empty())
+	{
+		auto Nucleus = Pending.back();
+		Pending.pop_back();
+		Out.Mix(Nucleus);
+		if (!Nucleus || !Visited.insert(Nucleus).second) continue;
+		switch (Nucleus->Kind)
+		{
+			case KindT::String:
+			{
+				auto String = static_cast<StringT *>(Nucleus);
+				Out.Mix(String->Initialized);
+				Out.Mix(String->Data);
+				break;
+			}
+#define CONTENTSNUMERIC(Name, DataT) \
+			case KindT::Name: \
+			{ \
+				auto Number = static_cast<NumericT<DataT> *>(Nucleus); \
+				Out.Mix(Number->Initialized); \
+				Out.Mix(Number->Data); \
+				break; \
+			}
+			CONTENTSNUMERIC(Int, int32_t)
+			CONTENTSNUMERIC(UInt, uint32_t)
+			CONTENTSNUMERIC(Float, float)
+			CONTENTSNUMERIC(Double, double)
+#undef CONTENTSNUMERIC
+			case KindT::Group:
+				for (auto &Member : *static_cast<GroupT *>(Nucleus))
+				{
+					Out.Mix(Member.first.ID);
+					Pending.push_back(Member.second);
+				}
+				break;
+			default: break;
+		}
+	}
+	return Out.Hash;
+}
+
+//================================================================================================================
+// Module stuff
+ModuleT::ModuleT(PositionT const Position) : 
+	NucleusT(Position, KindT::Module), 
+	Entry(false), 
+	Cache(nullptr), 
+	CollectBytes(0) 
+	{}
 
-void ModuleT::Simplify(ContextT Context)
+void ModuleT::Trace(VisitT const &Visit)
+{
+	NucleusT::Trace(Visit);
+	Visit(Top);
+}
+
+void ModuleT::Simplify(ContextT const &Context)
 {
 	if (!Top) ERROR;
 	auto TopGroup = Top.As<GroupT>();
 	
 	auto &LLVM = Context.LLVM;
 	if (Name.empty()) ERROR;
-	auto Module = new llvm::Module(Name.c_str(), LLVM);
+	auto Module = Context.Module;
+	if (Module)
+	{
+		// Functions compiled for earlier builds stay, the entry function is generated again
+		if (auto Constructors = Module->getNamedGlobal("llvm.global_ctors")) Constructors->eraseFromParent();
+		for (auto EntryName : {"main", "__ctor"})
+			if (auto Old = Module->getFunction(EntryName)) Old->eraseFromParent();
+	}
+	else Module = new llvm::Module(Name.c_str(), LLVM);
+	
+	TypeInternerT Types;
 	
 	NumericTypeT *ReturnType = nullptr;
 	
 	llvm::FunctionType *FunctionType = nullptr;
 	if (Entry)
 	{
-		ReturnType = new NumericTypeT(Context.Position);
-		ReturnType->Constant = false;
-		ReturnType->Static = false;
-		ReturnType->DataType = NumericTypeT::DataTypeT::Int;
+		ReturnType = Types.Numeric(Context.Position, DefaultTypeID, false, false, NumericTypeT::DataTypeT::Int);
 		FunctionType = llvm::FunctionType::get(
 			ReturnType->GenerateLLVMType(Context),
 			std::vector<llvm::Type *>
@@ -1336,30 +2823,62 @@ void ModuleT::Simplify(ContextT Context)
 	auto Function = llvm::Function::Create(FunctionType, llvm::Function::ExternalLinkage, Entry ? "main" : "__ctor", Module);
 	auto Block = llvm::BasicBlock::Create(LLVM, "entrypoint", Function);
 	
-	Assert(!Context.Module);
-	Context.Module = Module;
 	Assert(!Context.Block);
-	Context.Block = Block;
 	Assert(!Context.Scope);
 	Assert(Context.IsConstant);
+	Assert(!Context.Types);
+	auto ModuleContext = Context.WithModule(Module).WithBlock(Block).WithTypes(&Types).WithBudget(&Budget);
 	
 	DynamicT *ReturnValue = nullptr;
 	
 	if (Entry)
 	{
-		ReturnValue = new DynamicT(Context.Position);
+		ReturnValue = new DynamicT(ModuleContext.Position);
 		ReturnValue->Type = ReturnType;
-		ReturnValue->Target = new llvm::AllocaInst(ReturnType->GenerateLLVMType(Context), "", Context.Block);
+		ReturnValue->Target = new llvm::AllocaInst(ReturnType->GenerateLLVMType(ModuleContext), "", ModuleContext.Block);
 		ReturnValue->Initialized = false;
-		auto Out = TopGroup->AccessElement(Context, FunctionOutputKey).As<AssignableT>();
-		Out->Assign(Context, ReturnValue);
+		auto Out = TopGroup->AccessElement(ModuleContext, SymbolT::Output()).As<AssignableT>();
+		Out->Assign(ModuleContext, ReturnValue);
 	}
 
-	Top->Simplify(Context); // TODO position
+	auto Arena = ArenaT::Current();
+	if (Cache || (CollectBytes && Arena))
+	{
+		if (!TopGroup) ERROR;
+		auto &Statements = TopGroup->Statements;
+		
+		// Same as simplifying the group, but a statement at a time so each statement's accesses can be attributed 
+		// to it and garbage can be collected in between
+		auto TopContext = ModuleContext.WithScope(*TopGroup);
+		auto CollectedAt = AllocatedBytes;
+		for (size_t Index = 0; Index < Statements.size(); ++Index)
+		{
+			if (!Cache) SimplifyEngineT::Run(TopContext, Statements[Index]);
+			else if (!Cache->Restore(TopContext, **TopGroup, Index))
+			{
+				StatementDependenciesT Statement(*TopGroup);
+				auto const Last = Block->empty() ? nullptr : &Block->back();
+				SimplifyEngineT::Run(TopContext.WithDependencies(&Statement), Statements[Index]);
+				Statement.Emitted = (Block->empty() ? nullptr : &Block->back()) != Last;
+				std::sort(Statement.Specializations.begin(), Statement.Specializations.end());
+				Statement.Specializations.erase(
+					std::unique(Statement.Specializations.begin(), Statement.Specializations.end()), 
+					Statement.Specializations.end());
+				Cache->Record(TopContext, **TopGroup, Index, Statement);
+			}
+			
+			if (CollectBytes && Arena && (AllocatedBytes - CollectedAt >= CollectBytes))
+			{
+				Arena->Collect();
+				CollectedAt = AllocatedBytes;
+			}
+		}
+	}
+	else SimplifyEngineT::Run(ModuleContext, Top); // TODO position
 	
 	if (Entry)
 	{
-		llvm::ReturnInst::Create(Context.LLVM, ReturnValue->GenerateLLVMLoad(Context), Block);
+		llvm::ReturnInst::Create(Context.LLVM, ReturnValue->GenerateLLVMLoad(ModuleContext), Block);
 	}
 	else
 	{
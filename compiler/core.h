@@ -14,8 +14,12 @@
 #include "type.h"
 
 #include <string>
+#include <algorithm>
+#include <cmath>
 #include <functional>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <cassert>
 #include <memory>
@@ -23,6 +27,10 @@
 #include <sstream>
 #include <vector>
 #include <list>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <cstring>
 #define __STDC_CONSTANT_MACROS 
 #define __STDC_LIMIT_MACROS
 #include <llvm/IR/Module.h>
@@ -43,53 +51,190 @@
 #include <llvm/Support/raw_ostream.h>
 
 //#define ERROR assert(false)
-//#define ERROR { std::cout << "Error at " << Position->AsString() << std::endl; assert(false); } while (0)
-#define ERROR { std::cout << "Error at " << Context.Position->AsString() << std::endl; assert(false); } while (0)
+//#define ERROR { std::cout << "Error at " << Position.AsString() << std::endl; assert(false); } while (0)
+#define ERROR { std::cout << "Error at " << Context.Position.AsString() << std::endl; assert(false); } while (0)
 
 namespace Core
 {
 
-struct PositionBaseT
+//================================================================================================================
+// Memory
+/*
+Nuclei are carved out of the arena active on the current thread, if any, and from the heap otherwise.  Memory 
+freed while the arena is alive goes onto per-size free lists for reuse, and Release destroys whatever nuclei are 
+still alive and drops all memory at once.  Atoms still referring to the arena's nuclei are cleared by the release, 
+wherever they live, but nothing else allocated from it may outlive it.  References from the arena's nuclei out to 
+heap nuclei (or another arena's) are dropped normally, so those are freed once nothing else refers to them.
+*/
+struct NucleusT;
+struct ArenaT
+{
+	ArenaT(size_t BlockSize = 1 << 20);
+	ArenaT(ArenaT const &) = delete;
+	~ArenaT(void);
+	
+	void *Allocate(size_t Size);
+	void Free(void *Memory, size_t Size);
+	void Release(void);
+	
+	// Frees nuclei that are only referenced from other unreachable nuclei in this arena, like groups and the 
+	// elements that point back at them as their scope.  Any nucleus with a referrer outside the arena's nuclei 
+	// (an atom on the stack, in a heap nucleus, or a member Trace doesn't report) is kept along with everything it 
+	// reaches, so the roots don't have to be named.  Safe to run between modules.
+	struct CollectStatsT
+	{
+		size_t Scanned, Freed, FreedBytes;
+		CollectStatsT(void);
+		CollectStatsT &operator +=(CollectStatsT const &Other);
+	};
+	CollectStatsT Collect(void);
+	CollectStatsT const &CollectTotals(void) const; // Summed over every Collect call
+	size_t Pooled(void) const; // Bytes returned to the free lists by nuclei freed one at a time, before release
+	
+	static ArenaT *Current(void);
+	
+	// Makes an arena current for the thread for the scope's lifetime
+	struct ScopeT
+	{
+		ScopeT(ArenaT &Arena);
+		ScopeT(ScopeT const &) = delete;
+		~ScopeT(void);
+		private:
+			ArenaT *Previous;
+	};
+	
+	static constexpr size_t Alignment = 16;
+	
+	private:
+		friend struct NucleusT;
+		static constexpr size_t MaxPooled = 512;
+		
+		size_t const BlockSize;
+		bool IsReleasing;
+		std::vector<std::unique_ptr<char[]>> Blocks;
+		char *Next, *End;
+		std::array<void *, MaxPooled / Alignment> FreeLists;
+		NucleusT *Live;
+		size_t PooledBytes; // Returned to the free lists
+		CollectStatsT Totals;
+};
+
+//================================================================================================================
+// Positions
+/*
+Positions are small ids into a process-wide table of source locations, which are only formatted when a diagnostic 
+is printed.  Id 0 is the invalid position.
+*/
+struct PositionT
 {
-	virtual ~PositionBaseT(void);
-	virtual std::string AsString(void) const = 0;
+	uint32_t ID;
+	
+	PositionT(void);
+	
+	// File and Function must outlive the table, like literals or InternFile results
+	static PositionT Hard(char const *File, char const *Function, int Line);
+	static PositionT Loaded(char const *File, size_t Offset);
+	static char const *InternFile(std::string const &File);
+	
+	std::string AsString(void) const;
 };
 
-typedef std::shared_ptr<PositionBaseT> PositionT;
+// Each expansion site registers its position once
+#define HARDPOSITION \
+	([](char const *Function) \
+	{ \
+		static PositionT const Position = PositionT::Hard(__FILE__, Function, __LINE__); \
+		return Position; \
+	}(__FUNCTION__))
+#define INVALIDPOSITION PositionT()
 
-#define HARDPOSITION std::make_shared<HardPositionT>(__FILE__, __FUNCTION__, __LINE__)
-#define INVALIDPOSITION std::make_shared<HardPositionT>("invalid", "", 0)
-struct HardPositionT : PositionBaseT
+//================================================================================================================
+// Symbols
+/*
+Symbols are small ids into a process-wide table of interned identifiers, so key comparisons and hashing are integer 
+operations.  Ids are stable for the life of the process; id 0 is the empty name.  The table is shared by the loader, 
+Core and code generation and may be used from any thread.
+*/
+struct SymbolT
 {
-	std::string const Position;
-	HardPositionT(char const *File, char const *Function, int Line);
-	std::string AsString(void) const override;
+	uint32_t ID;
+	
+	SymbolT(void);
+	explicit SymbolT(std::string const &Name);
+	
+	// Predefined, with fixed ids
+	static SymbolT Input(void);
+	static SymbolT Output(void);
+	
+	// The returned string lives as long as the table
+	std::string const &Name(void) const;
+	
+	bool operator ==(SymbolT const &Other) const;
+	bool operator !=(SymbolT const &Other) const;
 };
 
+}
+
+namespace std
+{
+template <> struct hash<Core::SymbolT>
+	{ size_t operator()(Core::SymbolT const &Symbol) const { return std::hash<uint32_t>()(Symbol.ID); } };
+}
+
+namespace Core
+{
+
 //================================================================================================================
 // Core
-struct ContextT;
-struct AtomT;
-struct NucleusT
+// Every concrete nucleus, for kind tags and kind-switch dispatch
+#define NUCLEUSKINDS(X) \
+	X(Undefined, UndefinedT) \
+	X(Implement, ImplementT) \
+	X(String, StringT) \
+	X(StringType, StringTypeT) \
+	X(Int, NumericT<int32_t>) \
+	X(UInt, NumericT<uint32_t>) \
+	X(Float, NumericT<float>) \
+	X(Double, NumericT<double>) \
+	X(Dynamic, DynamicT) \
+	X(NumericType, NumericTypeT) \
+	X(Group, GroupT) \
+	X(Block, BlockT) \
+	X(Element, ElementT) \
+	X(AsDynamicType, AsDynamicTypeT) \
+	X(Assignment, AssignmentT) \
+	X(BinaryOperation, BinaryOperationT) \
+	X(Function, FunctionT) \
+	X(FunctionType, FunctionTypeT) \
+	X(Call, CallT) \
+	X(Module, ModuleT)
+
+enum struct KindT : uint8_t
 {
-	private:
-		friend struct AtomT;
-		std::vector<AtomT *> Atoms;
-	protected:
-		PositionT const Position;
-		NucleusT(PositionT const Position);
-		void Replace(NucleusT *Replacement);
-	public:
-		virtual ~NucleusT(void);
-		virtual AtomT Clone(void);
-		virtual AtomT GetType(ContextT Context);
-		virtual void Simplify(ContextT Context);
+#define KINDENUM(Name, Type) Name,
+	NUCLEUSKINDS(KINDENUM)
+#undef KINDENUM
 };
 
+struct ContextT;
+struct NucleusT;
+struct TypeInternerT;
+struct SimplifyEngineT;
+struct StatementDependenciesT;
+struct EvaluationBudgetT;
 struct AtomT
 {
 	private:
+		friend struct NucleusT;
+		friend struct ArenaT;
 		NucleusT *Nucleus;
+		AtomT *Previous, *Next;
+		void Attach(NucleusT *Nucleus);
+		void Detach(void);
+		
+		// Follows replaced nuclei to the current one.  Resolve also repoints the atom there.
+		static NucleusT *Follow(NucleusT *Nucleus);
+		NucleusT *Resolve(void);
 	
 	public:
 		void Set(NucleusT *Nucleus);
@@ -101,48 +246,150 @@ struct AtomT
 		
 		AtomT &operator =(NucleusT *Nucleus);
 		AtomT &operator =(AtomT &Other);
+		AtomT &operator =(AtomT &&Other);
 	
 		operator NucleusT *(void);
 		operator bool(void) const;
 		bool operator !(void) const;
 		
-		template <typename AsT> OptionalT<AsT *> As(void) 
-		{ 
-			auto Out = dynamic_cast<AsT *>(Nucleus);
-			if (!Out) return {};
-			return {Out};
-		}
-		
-		template <typename AsT> OptionalT<AsT const *> As(void) const
-		{ 
-			auto Out = dynamic_cast<AsT const *>(Nucleus);
-			if (!Out) return {};
-			return {Out};
-		}
+		// Kind checks, see the end of this file
+		template <typename AsT> OptionalT<AsT *> As(void);
+		template <typename AsT> OptionalT<AsT const *> As(void) const;
+		KindT Kind(void) const;
 		
 		NucleusT *operator ->(void);
 };
 
+struct NucleusT
+{
+	private:
+		friend struct AtomT;
+		friend struct ArenaT;
+		ArenaT *const Arena;
+		NucleusT *LivePrevious, *LiveNext;
+		AtomT *Atoms; // Intrusive list of referring atoms
+		AtomT Forward; // Set once replaced; the nucleus is then only a stub that atoms pass through
+	protected:
+		PositionT const Position;
+		NucleusT(PositionT const Position, KindT Kind);
+		void Replace(NucleusT *Replacement);
+	public:
+		KindT const Kind;
+		uint8_t const Interfaces; // See InterfaceBitT
+		
+		static void *operator new(size_t Size);
+		static void operator delete(void *Memory, size_t Size);
+		virtual ~NucleusT(void);
+		virtual AtomT Clone(void);
+		virtual AtomT GetType(ContextT const &Context);
+		
+		// Simplification is driven by SimplifyEngineT in two steps.  Schedule requests the node's own Simplify and 
+		// then its children's simplification, so the children are done by the time Simplify runs.  The default 
+		// schedules just Simplify.
+		virtual void Schedule(SimplifyEngineT &Engine, ContextT const &Context);
+		virtual void Simplify(ContextT const &Context);
+		
+		// Reports every atom the nucleus holds, for cycle collection
+		typedef std::function<void(AtomT &Atom)> VisitT;
+		virtual void Trace(VisitT const &Visit);
+};
+
+// Passed down by reference; a callee that needs different settings makes a scoped copy with the With methods.  
+// Copies are a handful of words, with no reference counting.
 struct ContextT
 {
 	llvm::LLVMContext &LLVM;
 	llvm::Module *Module;
 	
 	llvm::BasicBlock *Block;
-	AtomT Scope;
+	NucleusT *Scope;
 	
 	PositionT Position;
 	
 	bool IsConstant;
 	
+	TypeInternerT *Types; // Null if types aren't canonicalized
+	
+	StatementDependenciesT *Dependencies; // Null unless a statement cache is recording the top-level statement
+	
+	EvaluationBudgetT *Budget; // Null if constant calls may evaluate without limit
+	
 	ContextT(
 		llvm::LLVMContext &LLVM, 
 		llvm::Module *Module, 
 		llvm::BasicBlock *Block, 
-		AtomT Scope,
+		NucleusT *Scope,
 		PositionT Position,
 		bool IsConstant);
-	ContextT(ContextT const &Context);
+	
+	ContextT WithModule(llvm::Module *Module) const;
+	ContextT WithBlock(llvm::BasicBlock *Block) const;
+	ContextT WithScope(NucleusT *Scope) const;
+	ContextT WithPosition(PositionT Position) const;
+	ContextT WithConstant(bool IsConstant) const;
+	ContextT WithTypes(TypeInternerT *Types) const;
+	ContextT WithDependencies(StatementDependenciesT *Dependencies) const;
+	ContextT WithBudget(EvaluationBudgetT *Budget) const;
+};
+
+// Simplifies trees from an explicit stack of tasks, so nesting depth doesn't consume native stack.  Work that 
+// would otherwise recurse during a Simplify (a called function's body, assigning nested groups) is queued on the 
+// running engine with Nest.
+struct SimplifyEngineT
+{
+	static void Run(ContextT const &Context, AtomT Node);
+	
+	// Calls Queue with the engine running on this thread, so what it queues runs before the tasks already waiting.  
+	// Outside of a run, a new engine runs everything queued before Nest returns.
+	static void Nest(std::function<void(SimplifyEngineT &Engine)> const &Queue);
+	
+	// For Schedule implementations.  Tasks run last-requested first.
+	void Schedule(ContextT const &Context, AtomT Node);
+	void Simplify(ContextT const &Context, AtomT Node);
+	void Assign(ContextT const &Context, AtomT Node, AtomT Other);
+	void Continue(ContextT const &Context, std::function<void(void)> &&Step);
+	
+	private:
+		struct TaskT
+		{
+			enum struct StepT : uint8_t { Schedule, Simplify, Assign, Continue } Step;
+			AtomT Node, Other;
+			ContextT Context;
+		};
+		std::vector<TaskT> Tasks;
+		std::vector<std::function<void(void)>> Continuations; // One per Continue task, in the same order
+		
+		SimplifyEngineT(void);
+		void Finish(void);
+};
+
+// Calls with only constant inputs and outputs are evaluated while simplifying instead of being compiled.  The 
+// budget bounds the work of each outermost such call, including the constant calls it makes in turn.  Steps are 
+// simplification tasks and bytes are nuclei allocated; exceeding either is an error.  Modules can set their own 
+// limits, see Load.
+struct EvaluationBudgetT
+{
+	size_t MaxSteps, MaxBytes;
+	size_t Evaluated; // Calls evaluated so far; memoized results aren't counted
+	
+	EvaluationBudgetT(void);
+	
+	// Charges work to the budget while any scope is alive; the outermost one starts a fresh count.  The budget 
+	// may be null.
+	struct ScopeT
+	{
+		ScopeT(EvaluationBudgetT *Budget);
+		ScopeT(ScopeT const &) = delete;
+		~ScopeT(void);
+		private:
+			EvaluationBudgetT *Budget;
+	};
+	
+	// For SimplifyEngineT
+	void Step(ContextT const &Context);
+	
+	private:
+		size_t Depth, Steps, StartBytes;
 };
 
 //================================================================================================================
@@ -150,34 +397,34 @@ struct ContextT
 struct TypeT
 {
 	virtual ~TypeT(void);
-	virtual AtomT Allocate(ContextT Context, AtomT Value) = 0;
+	virtual AtomT Allocate(ContextT const &Context, AtomT Value) = 0;
 	virtual bool IsDynamic(void) = 0;
-	virtual void CheckType(ContextT Context, AtomT Other) = 0;
+	virtual void CheckType(ContextT const &Context, AtomT Other) = 0;
 };
 
 struct AssignableT
 {
 	virtual ~AssignableT(void);
-	virtual void Assign(ContextT Context, AtomT Other) = 0;
+	virtual void Assign(ContextT const &Context, AtomT Other) = 0;
 };
 
 // LLVM
 struct LLVMLoadableT
 {
 	virtual ~LLVMLoadableT(void);
-	virtual llvm::Value *GenerateLLVMLoad(ContextT Context) = 0;
+	virtual llvm::Value *GenerateLLVMLoad(ContextT const &Context) = 0;
 };
 
 struct LLVMLoadableTypeT
 {
 	virtual ~LLVMLoadableTypeT(void);
-	virtual llvm::Type *GenerateLLVMType(ContextT Context) = 0;
+	virtual llvm::Type *GenerateLLVMType(ContextT const &Context) = 0;
 };
 
 struct LLVMAssignableTypeT
 {
 	virtual ~LLVMAssignableTypeT(void);
-	virtual void AssignLLVM(ContextT Context, bool &Initialized, llvm::Value *Target, AtomT Other) = 0;
+	virtual void AssignLLVM(ContextT const &Context, bool &Initialized, llvm::Value *Target, AtomT Other) = 0;
 };
 
 //================================================================================================================
@@ -185,7 +432,7 @@ struct LLVMAssignableTypeT
 struct UndefinedT : NucleusT, AssignableT
 {
 	UndefinedT(PositionT const Position);
-	void Assign(ContextT Context, AtomT Other) override;
+	void Assign(ContextT const &Context, AtomT Other) override;
 };
 
 struct ImplementT : NucleusT
@@ -194,15 +441,17 @@ struct ImplementT : NucleusT
 	
 	ImplementT(PositionT const Position);
 	AtomT Clone(void) override;
-	AtomT GetType(ContextT Context) override;
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	AtomT GetType(ContextT const &Context) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
 };
 
 //================================================================================================================
 // Primitives
 
 struct StringTypeT;
-struct StringT : virtual NucleusT, virtual AssignableT
+struct StringT : NucleusT, AssignableT
 {
 	bool Initialized;
 	AtomT Type;
@@ -210,8 +459,10 @@ struct StringT : virtual NucleusT, virtual AssignableT
 	
 	StringT(PositionT const Position);
 	AtomT Clone(void) override;
-	AtomT GetType(ContextT Context) override;
-	void Assign(ContextT Context, AtomT Other) override;
+	void Trace(VisitT const &Visit) override;
+	AtomT GetType(ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
+	void Assign(ContextT const &Context, AtomT Other) override;
 };
 
 struct StringTypeT : NucleusT, TypeT
@@ -219,19 +470,19 @@ struct StringTypeT : NucleusT, TypeT
 	uint16_t ID;
 	// No dynamic strings, for now at least
 	bool Static;
+	// Canonical in a TypeInternerT, so it's never replaced and clones can share it
+	bool Interned;
 	
 	StringTypeT(PositionT const Position);
 	AtomT Clone(void) override;
+	void Simplify(ContextT const &Context) override;
 	bool IsDynamic(void) override;
-	void CheckType(ContextT Context, AtomT Other) override;
-	AtomT Allocate(ContextT Context, AtomT Value) override;
-	void Assign(ContextT Context, bool &Initialized, std::string &Data, AtomT Other);
+	void CheckType(ContextT const &Context, AtomT Other) override;
+	AtomT Allocate(ContextT const &Context, AtomT Value) override;
+	void Assign(ContextT const &Context, bool &Initialized, std::string &Data, AtomT Other);
 };
 
-template <typename DataT> struct NumericT : 
-	virtual NucleusT, 
-	virtual AssignableT, 
-	virtual LLVMLoadableT
+template <typename DataT> struct NumericT : NucleusT, AssignableT, LLVMLoadableT
 {
 	bool Initialized;
 	AtomT Type;
@@ -239,9 +490,11 @@ template <typename DataT> struct NumericT :
 	
 	NumericT(PositionT const Position);
 	AtomT Clone(void) override;
-	AtomT GetType(ContextT Context) override;
-	void Assign(ContextT Context, AtomT Other) override;
-	llvm::Value *GenerateLLVMLoad(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	AtomT GetType(ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
+	void Assign(ContextT const &Context, AtomT Other) override;
+	llvm::Value *GenerateLLVMLoad(ContextT const &Context) override;
 };
 
 struct DynamicT : NucleusT, AssignableT, LLVMLoadableT
@@ -258,10 +511,11 @@ struct DynamicT : NucleusT, AssignableT, LLVMLoadableT
 	
 	DynamicT(PositionT const Position);
 	
-	AtomT GetType(ContextT Context) override;
-	llvm::Value *GetTarget(ContextT Context);
-	void Assign(ContextT Context, AtomT Other) override;
-	llvm::Value *GenerateLLVMLoad(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	AtomT GetType(ContextT const &Context) override;
+	llvm::Value *GetTarget(ContextT const &Context);
+	void Assign(ContextT const &Context, AtomT Other) override;
+	llvm::Value *GenerateLLVMLoad(ContextT const &Context) override;
 };
 
 typedef uint64_t TypeIDT;
@@ -271,27 +525,57 @@ struct NumericTypeT : NucleusT, TypeT, LLVMLoadableTypeT, LLVMAssignableTypeT
 	bool Constant;
 	bool Static;
 	enum struct DataTypeT { Int, UInt, Float, Double } DataType;
+	// Canonical in a TypeInternerT, so it's never replaced and clones can share it
+	bool Interned;
 	
 	NumericTypeT(PositionT const Position);
 	AtomT Clone(void) override;
+	void Simplify(ContextT const &Context) override;
 	bool IsDynamic(void) override;
 	bool IsSigned(void) const;
-	void CheckType(ContextT Context, AtomT Other) override;
-	AtomT Allocate(ContextT Context, AtomT Value) override;
-	void AssignLLVM(ContextT Context, bool &Initialized, llvm::Value *Target, AtomT Other) override;
-	llvm::Type *GenerateLLVMType(ContextT Context) override;
+	void CheckType(ContextT const &Context, AtomT Other) override;
+	AtomT Allocate(ContextT const &Context, AtomT Value) override;
+	void AssignLLVM(ContextT const &Context, bool &Initialized, llvm::Value *Target, AtomT Other) override;
+	llvm::Type *GenerateLLVMType(ContextT const &Context) override;
 };
 
 //================================================================================================================
 // Groups
+/*
+Members are stored flat in insertion order.  Small groups are searched linearly; past IndexThreshold members a hash 
+index is kept.  Iteration is always in key name order, which function argument layout depends on.
+*/
 struct GroupCollectionT
 {
-	std::map<std::string, AtomT> Keys;
-
-	OptionalT<AtomT> GetByKey(std::string const &Key);
-	void Add(std::string const &Key, AtomT Value);
-	auto begin(void) -> decltype(Keys.begin());
-	auto end(void) -> decltype(Keys.end());
+	typedef std::pair<SymbolT, AtomT> MemberT;
+	
+	struct IteratorT
+	{
+		IteratorT(std::vector<MemberT> &Members, std::vector<uint32_t>::const_iterator Position);
+		MemberT &operator *(void) const;
+		MemberT *operator ->(void) const;
+		IteratorT &operator ++(void);
+		bool operator !=(IteratorT const &Other) const;
+		
+		private:
+			std::vector<MemberT> &Members;
+			std::vector<uint32_t>::const_iterator Position;
+	};
+	
+	OptionalT<AtomT> GetByKey(SymbolT const Key);
+	void Add(SymbolT const Key, AtomT Value);
+	size_t size(void) const;
+	IteratorT begin(void);
+	IteratorT end(void);
+	
+	private:
+		static constexpr size_t IndexThreshold = 8;
+		std::vector<MemberT> Members;
+		std::vector<uint32_t> Order; // Indices into Members, sorted by key name
+		std::vector<std::string const *> Names; // Each member's key name, so ordering doesn't lock the symbol table
+		std::unordered_map<SymbolT, uint32_t> Index; // Empty until IndexThreshold is passed
+		
+		OptionalT<uint32_t> Find(SymbolT const Key) const;
 };
 
 struct GroupT : NucleusT, AssignableT, GroupCollectionT
@@ -301,10 +585,11 @@ struct GroupT : NucleusT, AssignableT, GroupCollectionT
 
 	GroupT(PositionT const Position);
 	AtomT Clone(void) override;
-	void Simplify(ContextT Context) override;
-	void Assign(ContextT Context, AtomT Other) override;
-	AtomT AccessElement(ContextT Context, std::string const &Key);
-	AtomT AccessElement(ContextT Context, AtomT Key);
+	void Trace(VisitT const &Visit) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Assign(ContextT const &Context, AtomT Other) override;
+	AtomT AccessElement(ContextT const &Context, SymbolT const Key);
+	AtomT AccessElement(ContextT const &Context, AtomT Key);
 };
 
 struct BlockT : NucleusT
@@ -313,17 +598,21 @@ struct BlockT : NucleusT
 	
 	BlockT(PositionT const Position);
 	AtomT Clone(void) override;
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	void Simplify(ContextT const &Context) override;
 	AtomT CloneGroup(void);
 };
 
 struct ElementT : NucleusT
 {
 	AtomT Base, Key;
+	SymbolT Name; // Used when there's no Key expression
 
 	ElementT(PositionT const Position);
 	AtomT Clone(void) override;
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
 };
 
 //================================================================================================================
@@ -334,7 +623,9 @@ struct AsDynamicTypeT : NucleusT
 	
 	AsDynamicTypeT(PositionT const Position);
 	AtomT Clone(void) override;
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
 };
 
 //================================================================================================================
@@ -345,7 +636,46 @@ struct AssignmentT : NucleusT
 
 	AssignmentT(PositionT const Position);
 	AtomT Clone(void) override;
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
+};
+
+//================================================================================================================
+// Operations
+/*
+Numeric operands are promoted to the wider of their data types (double, then float, then uint if both are uint, 
+otherwise int), and must share a type ID.  Comparisons give an int 0 or 1.  Bitwise operations need integers.  If both 
+operands are constant the result is folded into a constant, otherwise instructions are generated.
+*/
+struct BinaryOperationT : NucleusT
+{
+	enum struct OperatorT : uint8_t
+	{
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Remainder,
+		Equal,
+		NotEqual,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		And,
+		Or,
+		Xor,
+		ShiftLeft,
+		ShiftRight
+	} Operator;
+	AtomT Left, Right;
+	
+	BinaryOperationT(PositionT const Position);
+	AtomT Clone(void) override;
+	void Trace(VisitT const &Visit) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
 };
 
 //================================================================================================================
@@ -365,6 +695,7 @@ template <typename TypeT> struct FunctionTreeT
 		{
 			auto &Branch = Position->Branches[Key];
 			if (!Branch) Branch.reset(new ElementT);
+			Position = Branch.get();
 		}
 		
 		operator bool(void) const { return Position->Leaf; }
@@ -383,18 +714,28 @@ struct FunctionT : NucleusT
 	
 	struct CachedLLVMFunctionT
 	{
-		llvm::Value *Function;
+		llvm::Value *Function; // Null if the specialization has only been evaluated
 		bool IsConstant;
+		std::vector<AtomT> ConstantOutputs; // Constant parts of a compiled specialization's output, in output order
+		
+		// Constant calls
+		bool Evaluating;
+		AtomT Output; // Memoized result, copied for each call
 	};
 	FunctionTreeT<CachedLLVMFunctionT> InstanceTree;
 	
 	FunctionT(PositionT const Position);
-	AtomT GetType(ContextT Context) override;
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	AtomT GetType(ContextT const &Context) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
 	
-	AtomT Call(ContextT Context, AtomT Input);
+	AtomT Call(ContextT const &Context, AtomT Input);
 };
 
+// Copies a constant value so the copy can be modified independently.  Functions are never modified, so they're 
+// shared.
+AtomT CopyConstant(ContextT const &Context, AtomT &Value);
+
 struct FunctionTypeT : NucleusT, TypeT, LLVMLoadableTypeT, LLVMAssignableTypeT
 {
 	uint16_t ID;
@@ -411,14 +752,16 @@ struct FunctionTypeT : NucleusT, TypeT, LLVMLoadableTypeT, LLVMAssignableTypeT
 	
 	FunctionTypeT(PositionT const Position);
 	AtomT Clone(void) override;
-	void Simplify(ContextT Context) override;
-	AtomT Allocate(ContextT Context, AtomT Value) override;
+	void Trace(VisitT const &Visit) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
+	AtomT Allocate(ContextT const &Context, AtomT Value) override;
 	bool IsDynamic(void) override;
-	void CheckType(ContextT Context, AtomT Other) override;
-	llvm::Type *GenerateLLVMType(ContextT Context) override;
-	void AssignLLVM(ContextT Context, bool &Initialized, llvm::Value *Target, AtomT Other) override;
+	void CheckType(ContextT const &Context, AtomT Other) override;
+	llvm::Type *GenerateLLVMType(ContextT const &Context) override;
+	void AssignLLVM(ContextT const &Context, bool &Initialized, llvm::Value *Target, AtomT Other) override;
 	
-	AtomT Call(ContextT Context, AtomT Body, AtomT Input);
+	AtomT Call(ContextT const &Context, AtomT Body, AtomT Input);
 	
 	struct GenerateLLVMTypeParamsT {};
 	struct GenerateLLVMTypeResultsT
@@ -445,7 +788,7 @@ struct FunctionTypeT : NucleusT, TypeT, LLVMLoadableTypeT, LLVMAssignableTypeT
 	typedef VariantT<GenerateLLVMTypeParamsT, GenerateLLVMLoadParamsT, CallParamsT> ProcessFunctionParamT;
 	typedef VariantT<GenerateLLVMTypeResultsT, GenerateLLVMLoadResultsT, CallResultsT> ProcessFunctionResultT;
 	
-	ProcessFunctionResultT ProcessFunction(ContextT Context, ProcessFunctionParamT Param);
+	ProcessFunctionResultT ProcessFunction(ContextT const &Context, ProcessFunctionParamT Param);
 };
 
 struct CallT : NucleusT
@@ -454,9 +797,70 @@ struct CallT : NucleusT
 	
 	CallT(PositionT const Position);
 	AtomT Clone(void) override;
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	void Schedule(SimplifyEngineT &Engine, ContextT const &Context) override;
+	void Simplify(ContextT const &Context) override;
 };
 
+//================================================================================================================
+// Type interning
+// One canonical instance per structurally identical type, so equal types are equal pointers and share their cached 
+// LLVM types.  Function types are nominal and interned by ID.  Interned types are shared: clone before modifying.
+struct TypeInternerT
+{
+	NucleusT *Intern(NucleusT *Type);
+	NumericTypeT *Numeric(PositionT const Position, uint16_t ID, bool Constant, bool Static, NumericTypeT::DataTypeT DataType);
+	StringTypeT *String(PositionT const Position, uint16_t ID, bool Static);
+	
+	private:
+		std::unordered_map<uint64_t, AtomT> Numerics, Strings, Functions;
+};
+
+//================================================================================================================
+// Dependency tracking
+// What one top-level module statement touched while it was simplified, for incremental builds
+struct StatementDependenciesT
+{
+	GroupT *const Top; // Only accesses of the module's top group are recorded
+	
+	struct AccessT
+	{
+		SymbolT Key;
+		NucleusT *Before; // What the key held when first accessed, null if it was added by the access
+		uint64_t Contents; // Of Before, see Contents
+	};
+	std::vector<AccessT> Accesses; // One per key, in order of first access
+	std::vector<uint64_t> Specializations; // Function specializations called, by type ID and argument key
+	bool Emitted; // Added instructions to the module's entry function
+	
+	StatementDependenciesT(GroupT *Top);
+	void Access(SymbolT const Key, NucleusT *Before);
+	
+	private:
+		std::unordered_set<uint32_t> Seen;
+};
+
+// Lets a module skip top-level statements whose effects can be restored without simplifying them, see 
+// incremental.h
+struct StatementCacheT
+{
+	virtual ~StatementCacheT(void);
+	
+	// Called before each top-level statement; true if its effects on Top were restored, so it's skipped
+	virtual bool Restore(ContextT const &Context, GroupT &Top, size_t Index) = 0;
+	
+	// Called after each top-level statement that was simplified
+	virtual void Record(ContextT const &Context, GroupT &Top, size_t Index, StatementDependenciesT &Dependencies) = 0;
+};
+
+// Hashes a tree's kinds and data (but not positions), so trees built from identical source match across runs.  
+// Only meaningful before the tree is simplified.
+uint64_t Fingerprint(AtomT &Node);
+
+// Hashes a value's identity and what assigning through it can change: the data of numbers and strings and the 
+// members of groups, recursively.  Other nuclei are only hashed by identity.
+uint64_t Contents(NucleusT *Value);
+
 //================================================================================================================
 // Module stuff
 struct ModuleT : NucleusT
@@ -465,10 +869,79 @@ struct ModuleT : NucleusT
 	bool Entry;
 	AtomT Top;
 	
+	// If set, top-level statements are simplified one at a time and the cache may restore them instead.  With a 
+	// module in the context, it's built into that one, replacing its entry function.
+	StatementCacheT *Cache;
+	
+	// If set and an arena is current, it's collected between top-level statements whenever this many bytes of 
+	// nuclei have been allocated since the last collection
+	size_t CollectBytes;
+	
+	EvaluationBudgetT Budget;
+	
 	ModuleT(PositionT const Position);
-	void Simplify(ContextT Context) override;
+	void Trace(VisitT const &Visit) override;
+	void Simplify(ContextT const &Context) override;
 };
 
+//================================================================================================================
+// Kind dispatch
+// Casts are a tag compare plus a static_cast; interfaces check a bit and then dispatch on the kind to upcast
+template <typename NodeT> struct KindOfT {};
+#define KINDOF(Name, Type) template <> struct KindOfT<Type> { static constexpr KindT Kind = KindT::Name; };
+NUCLEUSKINDS(KINDOF)
+#undef KINDOF
+
+template <typename InterfaceT> struct InterfaceBitT {};
+template <> struct InterfaceBitT<TypeT> { static constexpr uint8_t Bit = 1 << 0; };
+template <> struct InterfaceBitT<AssignableT> { static constexpr uint8_t Bit = 1 << 1; };
+template <> struct InterfaceBitT<LLVMLoadableT> { static constexpr uint8_t Bit = 1 << 2; };
+template <> struct InterfaceBitT<LLVMLoadableTypeT> { static constexpr uint8_t Bit = 1 << 3; };
+template <> struct InterfaceBitT<LLVMAssignableTypeT> { static constexpr uint8_t Bit = 1 << 4; };
+
+template <typename AsT, typename FromT> 
+	typename std::enable_if<std::is_base_of<AsT, FromT>::value, AsT *>::type UpcastNucleus(FromT *From) 
+	{ return From; }
+template <typename AsT, typename FromT> 
+	typename std::enable_if<!std::is_base_of<AsT, FromT>::value, AsT *>::type UpcastNucleus(FromT *) 
+	{ return nullptr; }
+
+template <typename AsT> AsT *CastNucleus(NucleusT *Nucleus, decltype(KindOfT<AsT>::Kind) const * = nullptr)
+{
+	if (Nucleus->Kind != KindOfT<AsT>::Kind) return nullptr;
+	return static_cast<AsT *>(Nucleus);
+}
+
+template <typename AsT> AsT *CastNucleus(NucleusT *Nucleus, decltype(InterfaceBitT<AsT>::Bit) const * = nullptr)
+{
+	if (!(Nucleus->Interfaces & InterfaceBitT<AsT>::Bit)) return nullptr;
+	switch (Nucleus->Kind)
+	{
+#define KINDCAST(Name, Type) case KindT::Name: return UpcastNucleus<AsT>(static_cast<Type *>(Nucleus));
+		NUCLEUSKINDS(KINDCAST)
+#undef KINDCAST
+	}
+	return nullptr;
+}
+
+template <typename AsT> OptionalT<AsT *> AtomT::As(void)
+{
+	auto Nucleus = Resolve();
+	if (!Nucleus) return {};
+	auto Out = CastNucleus<AsT>(Nucleus);
+	if (!Out) return {};
+	return {Out};
+}
+
+template <typename AsT> OptionalT<AsT const *> AtomT::As(void) const
+{
+	auto Nucleus = Follow(this->Nucleus);
+	if (!Nucleus) return {};
+	AsT const *Out = CastNucleus<AsT>(Nucleus);
+	if (!Out) return {};
+	return {Out};
+}
+
 }
 
 #endif
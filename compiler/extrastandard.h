@@ -32,6 +32,37 @@ struct StringT
 inline std::ostream &operator <<(std::ostream &Stream, StringT const &Value)
 	{ return Stream << (std::string)Value; }
 
+//----------------------------------------------------------------------------------------------------------------
+// Borrowed characters, a stand-in for C++17's string_view
+struct StringViewT
+{
+	private:
+		char const *Data;
+		size_t Length;
+	public:
+
+	StringViewT(void) : Data(nullptr), Length(0) {}
+	StringViewT(char const *Data, size_t Length) : Data(Data), Length(Length) {}
+	StringViewT(std::string const &Source) : Data(Source.data()), Length(Source.size()) {}
+	template <size_t Size> StringViewT(char const (&Literal)[Size]) : Data(Literal), Length(Size - 1) {}
+	char const *data(void) const { return Data; }
+	size_t size(void) const { return Length; }
+	bool empty(void) const { return !Length; }
+	char const *begin(void) const { return Data; }
+	char const *end(void) const { return Data + Length; }
+	char operator [](size_t Index) const { return Data[Index]; }
+	StringViewT substr(size_t Start) const { return Start >= Length ? StringViewT() : StringViewT(Data + Start, Length - Start); }
+	bool starts_with(StringViewT const &Prefix) const 
+		{ return (Prefix.Length <= Length) && std::equal(Prefix.begin(), Prefix.end(), Data); }
+	bool operator ==(StringViewT const &Other) const 
+		{ return (Other.Length == Length) && std::equal(begin(), end(), Other.Data); }
+	bool operator !=(StringViewT const &Other) const { return !(*this == Other); }
+	std::string str(void) const { return std::string(Data, Length); }
+};
+
+inline std::ostream &operator <<(std::ostream &Stream, StringViewT const &Value)
+	{ return Stream.write(Value.data(), Value.size()); }
+
 //----------------------------------------------------------------------------------------------------------------
 // Will be included in C++14 lolololol
 template<typename T, typename... Args> std::unique_ptr<T> make_unique(Args&&... args)
@@ -0,0 +1,205 @@
+#include "incremental.h"
+
+namespace Core
+{
+
+namespace
+{
+
+// Values that can be copied into another build: constants, groups of them, and functions
+bool Portable(NucleusT *Value)
+{
+	std::unordered_set<NucleusT *> Visited;
+	std::vector<NucleusT *> Pending{Value};
+	while (!Pending.empty())
+	{
+		auto Nucleus = Pending.back();
+		Pending.pop_back();
+		if (!Nucleus) return false;
+		if (!Visited.insert(Nucleus).second) continue;
+		switch (Nucleus->Kind)
+		{
+			case KindT::Group:
+				for (auto &Member : *static_cast<GroupT *>(Nucleus)) Pending.push_back(Member.second);
+				break;
+			case KindT::String:
+			case KindT::Int:
+			case KindT::UInt:
+			case KindT::Float:
+			case KindT::Double:
+			case KindT::Function:
+			case KindT::StringType:
+			case KindT::NumericType:
+			case KindT::FunctionType:
+				break;
+			default: return false;
+		}
+	}
+	return true;
+}
+
+}
+
+constexpr size_t SessionT::NoMatch;
+
+SessionT::StatsT::StatsT(void) : Simplified(0), Restored(0), Erased(0) {}
+
+SessionT::StatementT::StatementT(void) : Fingerprint(0), Previous(NoMatch), Restorable(false) {}
+
+SessionT::SessionT(llvm::LLVMContext &LLVM) : LLVM(LLVM) {}
+
+SessionT::~SessionT(void) {}
+
+auto SessionT::Build(AtomT &Module) -> StatsT
+{
+	auto Loaded = Module.As<ModuleT>();
+	Assert(Loaded);
+	auto Top = (*Loaded)->Top.As<GroupT>();
+	Assert(Top);
+
+	// Match statements in order; a previous statement that's skipped over is removed
+	Previous = std::move(Statements);
+	Statements.clear();
+	Statements.resize(Top->Statements.size());
+	std::unordered_map<uint64_t, std::deque<size_t>> Unmatched;
+	for (size_t Index = 0; Index < Previous.size(); ++Index) Unmatched[Previous[Index].Fingerprint].push_back(Index);
+	size_t Next = 0;
+	std::vector<bool> Matched(Previous.size(), false);
+	for (size_t Index = 0; Index < Statements.size(); ++Index)
+	{
+		auto &Statement = Statements[Index];
+		Statement.Fingerprint = Fingerprint(Top->Statements[Index]);
+		auto Found = Unmatched.find(Statement.Fingerprint);
+		if (Found == Unmatched.end()) continue;
+		auto &Candidates = Found->second;
+		while (!Candidates.empty() && (Candidates.front() < Next)) Candidates.pop_front();
+		if (Candidates.empty()) continue;
+		Statement.Previous = Candidates.front();
+		Matched[Statement.Previous] = true;
+		Next = Statement.Previous + 1;
+	}
+	Written.clear();
+	for (size_t Index = 0; Index < Previous.size(); ++Index)
+		if (!Matched[Index]) Taint(Previous[Index]);
+
+	if (!this->Module) this->Module.reset(new llvm::Module((*Loaded)->Name.c_str(), LLVM));
+	Stats = StatsT();
+	(*Loaded)->Cache = this;
+	SimplifyEngineT::Run(ContextT(LLVM, this->Module.get(), nullptr, nullptr, HARDPOSITION, true), Module);
+	(*Loaded)->Cache = nullptr;
+	Previous.clear();
+	Stats.Erased = Erase(**Top);
+	return Stats;
+}
+
+llvm::Module *SessionT::Output(void) { return Module.get(); }
+
+bool SessionT::Restore(ContextT const &Context, GroupT &Top, size_t Index)
+{
+	auto &Statement = Statements[Index];
+	if (Statement.Previous != NoMatch)
+	{
+		auto &Old = Previous[Statement.Previous];
+		bool Restorable = Old.Restorable && !Touches(Old);
+		for (auto &Added : Old.Added)
+			if (Top.GetByKey(Added.first)) Restorable = false;
+		if (Restorable)
+		{
+			for (auto &Added : Old.Added) Top.Add(Added.first, CopyConstant(Context, Added.second));
+			auto const Fingerprint = Statement.Fingerprint;
+			Statement = std::move(Old);
+			Statement.Fingerprint = Fingerprint;
+			Statement.Previous = NoMatch;
+			++Stats.Restored;
+			return true;
+		}
+		// The old version's writes may differ from the new one's
+		Taint(Old);
+	}
+	++Stats.Simplified;
+	return false;
+}
+
+void SessionT::Record(ContextT const &Context, GroupT &Top, size_t Index, StatementDependenciesT &Dependencies)
+{
+	auto &Statement = Statements[Index];
+	Statement.Restorable = !Dependencies.Emitted;
+
+	std::unordered_set<NucleusT *> Before;
+	for (auto &Access : Dependencies.Accesses)
+		if (Access.Before) Before.insert(Access.Before);
+
+	std::vector<std::pair<SymbolT, AtomT>> Added;
+	for (auto &Access : Dependencies.Accesses)
+	{
+		auto Got = Top.GetByKey(Access.Key);
+		NucleusT *After = Got ? static_cast<NucleusT *>(*Got) : nullptr;
+		bool const Wrote = !Access.Before || (After != Access.Before) || (Contents(After) != Access.Contents);
+		(Wrote ? Statement.Writes : Statement.Reads).push_back(Access.Key);
+		if (!Wrote) continue;
+		// Values that already existed were modified in place, and may be shared with other keys
+		if (Access.Before || !After || Before.count(After) || !Portable(After)) Statement.Restorable = false;
+		else Added.emplace_back(Access.Key, *Got);
+	}
+	if (Statement.Restorable)
+		for (auto &Pair : Added) Statement.Added.emplace_back(Pair.first, CopyConstant(Context, Pair.second));
+	Taint(Statement);
+}
+
+bool SessionT::Touches(StatementT const &Statement) const
+{
+	for (auto const *Keys : {&Statement.Reads, &Statement.Writes})
+		for (auto &Key : *Keys)
+			if (Written.count(Key.ID)) return true;
+	return false;
+}
+
+void SessionT::Taint(StatementT const &Statement)
+{
+	for (auto &Key : Statement.Writes) Written.insert(Key.ID);
+}
+
+// Erases functions nothing calls that no reachable function value can call again
+size_t SessionT::Erase(GroupT &Top)
+{
+	std::unordered_set<llvm::Value *> Live;
+	std::unordered_set<NucleusT *> Visited;
+	std::vector<NucleusT *> Pending{&Top};
+	for (auto &Statement : Statements)
+		for (auto &Added : Statement.Added) Pending.push_back(Added.second);
+	while (!Pending.empty())
+	{
+		auto Nucleus = Pending.back();
+		Pending.pop_back();
+		if (!Nucleus || !Visited.insert(Nucleus).second) continue;
+		Nucleus->Trace([&Pending](AtomT &Child) { Pending.push_back(Child); });
+		if (Nucleus->Kind != KindT::Function) continue;
+		std::vector<FunctionTreeT<FunctionT::CachedLLVMFunctionT>::ElementT *> Instances
+			{&static_cast<FunctionT *>(Nucleus)->InstanceTree.Root};
+		while (!Instances.empty())
+		{
+			auto Instance = Instances.back();
+			Instances.pop_back();
+			if (Instance->Leaf && Instance->Leaf->Function) Live.insert(Instance->Leaf->Function);
+			for (auto &Branch : Instance->Branches) Instances.push_back(Branch.second.get());
+		}
+	}
+
+	// Erasing a function can leave the ones only it called unused
+	size_t Out = 0;
+	for (bool Erased = true; Erased; )
+	{
+		Erased = false;
+		for (auto Function = Module->begin(); Function != Module->end(); )
+		{
+			auto &Candidate = *Function++;
+			if (!Candidate.hasLocalLinkage() || !Candidate.use_empty() || Live.count(&Candidate)) continue;
+			Candidate.eraseFromParent();
+			Erased = true;
+			++Out;
+		}
+	}
+	return Out;
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef incremental_h
+#define incremental_h
+
+#include "core.h"
+
+namespace Core
+{
+
+//================================================================================================================
+// Incremental builds
+/*
+A session rebuilds a module as it's edited.  It keeps the LLVM module and a record of each top-level statement
+between builds.  Each build matches its statements to the previous build's by fingerprint, in order, and restores
+a matched statement instead of simplifying it if the statement
+- emitted nothing into the entry function,
+- only added keys to the top group, with constant values (so not aliasing anything it read),
+- and touched no key that an earlier statement in this build wrote by being simplified again, or that a removed
+statement wrote.
+Restoring adds copies of the values the statement left in its keys.  Functions are shared between builds, so the
+specializations compiled for them stay valid in the retained module.  Everything else is simplified as usual, the
+entry function is generated again every build, and functions nothing can call any more are erased.
+
+Restored values refer to nuclei from earlier builds, so modules built in a session must be on the heap or in an
+arena that outlives it.
+*/
+struct SessionT : StatementCacheT
+{
+	struct StatsT
+	{
+		size_t Simplified, Restored, Erased; // Statements, and functions erased from the module
+		StatsT(void);
+	};
+
+	SessionT(llvm::LLVMContext &LLVM);
+	SessionT(SessionT const &) = delete;
+	~SessionT(void);
+
+	// Simplifies Module, a freshly loaded tree, into the retained module
+	StatsT Build(AtomT &Module);
+
+	llvm::Module *Output(void); // Null before the first build
+
+	bool Restore(ContextT const &Context, GroupT &Top, size_t Index) override;
+	void Record(ContextT const &Context, GroupT &Top, size_t Index, StatementDependenciesT &Dependencies) override;
+
+	private:
+		struct StatementT
+		{
+			uint64_t Fingerprint;
+			size_t Previous; // Matching statement in the previous build, or NoMatch
+			bool Restorable;
+			std::vector<SymbolT> Reads, Writes;
+			std::vector<std::pair<SymbolT, AtomT>> Added; // Copies of the values left in the statement's keys
+			StatementT(void);
+		};
+		static constexpr size_t NoMatch = static_cast<size_t>(-1);
+
+		llvm::LLVMContext &LLVM;
+		std::unique_ptr<llvm::Module> Module;
+		std::vector<StatementT> Statements, Previous;
+		std::unordered_set<uint32_t> Written; // Keys written by statements that were simplified this build
+		StatsT Stats;
+
+		bool Touches(StatementT const &Statement) const;
+		void Taint(StatementT const &Statement);
+		size_t Erase(GroupT &Top);
+};
+
+}
+
+#endif
@@ -0,0 +1,432 @@
+#include "loader.h"
+
+#include <limits>
+#include <exception>
+
+#include "serial.h"
+
+namespace Core
+{
+
+namespace
+{
+
+//----------------------------------------------------------------------------------------------------------------
+// Schema keys
+// Every object in the document shares one table; the enum must list keys in the same order.
+enum KeyT : Serial::KeyIDT
+{
+	KeyName,
+	KeyEntry,
+	KeyTop,
+	KeyUndefined,
+	KeyImplement,
+	KeyType,
+	KeyValue,
+	KeyString,
+	KeyInt,
+	KeyUint,
+	KeyFloat,
+	KeyDouble,
+	KeyStringType,
+	KeyId,
+	KeyStatic,
+	KeyNumericType,
+	KeyConstant,
+	KeyData,
+	KeyGroup,
+	KeyBlock,
+	KeyStatements,
+	KeyElement,
+	KeyBase,
+	KeyKey,
+	KeyDynamic,
+	KeyAssignment,
+	KeyLeft,
+	KeyRight,
+	KeyFunctionType,
+	KeySignature,
+	KeyCall,
+	KeyFunction,
+	KeyInput,
+	KeyBinary,
+	KeyOperator,
+	KeyEvaluationSteps,
+	KeyEvaluationBytes
+};
+
+Serial::KeyTableT const KeyTable
+{
+	"name",
+	"entry",
+	"top",
+	"undefined",
+	"implement",
+	"type",
+	"value",
+	"string",
+	"int",
+	"uint",
+	"float",
+	"double",
+	"string_type",
+	"id",
+	"static",
+	"numeric_type",
+	"constant",
+	"data",
+	"group",
+	"block",
+	"statements",
+	"element",
+	"base",
+	"key",
+	"dynamic",
+	"assignment",
+	"left",
+	"right",
+	"function_type",
+	"signature",
+	"call",
+	"function",
+	"input",
+	"binary",
+	"operator",
+	"evaluation_steps",
+	"evaluation_bytes"
+};
+
+// In BinaryOperationT::OperatorT order
+std::array<char const *, 16> const OperatorNames
+{{
+	"add",
+	"subtract",
+	"multiply",
+	"divide",
+	"remainder",
+	"equal",
+	"not_equal",
+	"less",
+	"less_equal",
+	"greater",
+	"greater_equal",
+	"and",
+	"or",
+	"xor",
+	"shift_left",
+	"shift_right"
+}};
+
+//----------------------------------------------------------------------------------------------------------------
+// Node readers
+struct LoaderT
+{
+	char const *const File;
+	Serial::ReadT *Reader;
+
+	LoaderT(std::string const &File) : File(PositionT::InternFile(File)), Reader(nullptr) {}
+
+	PositionT Here(void) { return PositionT::Loaded(File, Reader ? Reader->Offset() : 0); }
+
+	void Set(AtomT &Out, NucleusT *Nucleus)
+	{
+		AtomT Owned(Nucleus); // Freed if rejected
+		if (Out) throw ConstructionErrorT() << "Multiple kinds specified for node at " << Here().AsString();
+		Out = Owned;
+	}
+
+	// Replaces any default already in Out
+	void Field(Serial::ReadObjectT &Object, KeyT Key, AtomT &Out)
+		{ Object.Object(Key, [this, &Out](Serial::ReadObjectT &Object) { Out.Clear(); Node(Object, Out); }); }
+
+	void Statements(Serial::ReadObjectT &Object, std::vector<AtomT> &Out)
+	{
+		Object.Array(KeyStatements, [this, &Out](Serial::ReadArrayT &Array)
+		{
+			Array.Object([this, &Out](Serial::ReadObjectT &Object)
+			{
+				// The slot only needs to live until the node's object ends, which happens before the next statement
+				Out.emplace_back();
+				Node(Object, Out.back());
+			});
+		});
+	}
+
+	NumericTypeT *DefaultNumericType(PositionT const &Position, NumericTypeT::DataTypeT DataType)
+	{
+		auto Type = new NumericTypeT(Position);
+		Type->DataType = DataType;
+		Type->Constant = true;
+		Type->Static = false;
+		return Type;
+	}
+
+	// Registers a node kind, whose field object also reads with the shared key table
+	template <typename SetupT> void Kind(Serial::ReadObjectT &Object, KeyT Key, SetupT const &Setup)
+	{
+		Object.Object(Key, [Setup](Serial::ReadObjectT &Object)
+		{
+			Object.Keys(KeyTable);
+			Setup(Object);
+		});
+	}
+
+	void Module(Serial::ReadObjectT &Object, AtomT &Out);
+	void Node(Serial::ReadObjectT &Object, AtomT &Out);
+};
+
+void LoaderT::Module(Serial::ReadObjectT &Object, AtomT &Out)
+{
+	Object.Keys(KeyTable);
+	auto Module = new ModuleT(Here());
+	Out = Module;
+	Object.String(KeyName, [Module](std::string &&Value) { Module->Name = std::move(Value); });
+	Object.Bool(KeyEntry, [Module](bool Value) { Module->Entry = Value; });
+	Object.UInt(KeyEvaluationSteps, [Module](uint64_t Value) { Module->Budget.MaxSteps = Value; });
+	Object.UInt(KeyEvaluationBytes, [Module](uint64_t Value) { Module->Budget.MaxBytes = Value; });
+	Field(Object, KeyTop, Module->Top);
+}
+
+void LoaderT::Node(Serial::ReadObjectT &Object, AtomT &Out)
+{
+	Object.Keys(KeyTable);
+	auto const Start = Here();
+	Object.Destructor([&Out, Start](void)
+	{
+		// Objects cut short by an error are destroyed while it propagates, and have nothing more to report
+		if (!Out && !std::uncaught_exception()) 
+			throw ConstructionErrorT() << "Node has no kind at " << Start.AsString();
+	});
+
+	// Basics
+	Kind(Object, KeyUndefined, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		Set(Out, new UndefinedT(Here()));
+	});
+
+	Kind(Object, KeyImplement, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Implement = new ImplementT(Here());
+		Set(Out, Implement);
+		Field(Object, KeyType, Implement->Type);
+		Field(Object, KeyValue, Implement->Value);
+	});
+
+	// Primitives
+	Kind(Object, KeyString, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Position = Here();
+		auto String = new StringT(Position);
+		Set(Out, String);
+		auto Type = new StringTypeT(Position);
+		Type->Static = false;
+		String->Type = Type;
+		Field(Object, KeyType, String->Type);
+		Object.String(KeyValue, [String](std::string &&Value)
+		{
+			String->Data = std::move(Value);
+			String->Initialized = true;
+		});
+	});
+
+	Kind(Object, KeyInt, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Position = Here();
+		auto Number = new NumericT<int32_t>(Position);
+		Set(Out, Number);
+		Number->Type = DefaultNumericType(Position, NumericTypeT::DataTypeT::Int);
+		Field(Object, KeyType, Number->Type);
+		Object.Int(KeyValue, [this, Number](int64_t Value)
+		{
+			if ((Value < std::numeric_limits<int32_t>::min()) || (Value > std::numeric_limits<int32_t>::max()))
+				throw ConstructionErrorT() << "Int literal " << Value << " out of range at " << Here().AsString();
+			Number->Data = Value;
+			Number->Initialized = true;
+		});
+	});
+
+	Kind(Object, KeyUint, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Position = Here();
+		auto Number = new NumericT<uint32_t>(Position);
+		Set(Out, Number);
+		Number->Type = DefaultNumericType(Position, NumericTypeT::DataTypeT::UInt);
+		Field(Object, KeyType, Number->Type);
+		Object.UInt(KeyValue, [this, Number](uint64_t Value)
+		{
+			if (Value > std::numeric_limits<uint32_t>::max())
+				throw ConstructionErrorT() << "UInt literal " << Value << " out of range at " << Here().AsString();
+			Number->Data = Value;
+			Number->Initialized = true;
+		});
+	});
+
+	Kind(Object, KeyFloat, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Position = Here();
+		auto Number = new NumericT<float>(Position);
+		Set(Out, Number);
+		Number->Type = DefaultNumericType(Position, NumericTypeT::DataTypeT::Float);
+		Field(Object, KeyType, Number->Type);
+		Object.Float(KeyValue, [Number](float Value)
+		{
+			Number->Data = Value;
+			Number->Initialized = true;
+		});
+	});
+
+	Kind(Object, KeyDouble, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Position = Here();
+		auto Number = new NumericT<double>(Position);
+		Set(Out, Number);
+		Number->Type = DefaultNumericType(Position, NumericTypeT::DataTypeT::Double);
+		Field(Object, KeyType, Number->Type);
+		Object.Double(KeyValue, [Number](double Value)
+		{
+			Number->Data = Value;
+			Number->Initialized = true;
+		});
+	});
+
+	Kind(Object, KeyStringType, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Type = new StringTypeT(Here());
+		Set(Out, Type);
+		Object.UInt(KeyId, [Type](uint64_t Value) { Type->ID = Value; });
+		Object.Bool(KeyStatic, [Type](bool Value) { Type->Static = Value; });
+	});
+
+	Kind(Object, KeyNumericType, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Type = new NumericTypeT(Here());
+		Set(Out, Type);
+		Object.UInt(KeyId, [Type](uint64_t Value) { Type->ID = Value; });
+		Object.Bool(KeyConstant, [Type](bool Value) { Type->Constant = Value; });
+		Object.Bool(KeyStatic, [Type](bool Value) { Type->Static = Value; });
+		Object.StringView(KeyData, [this, Type](StringViewT Value)
+		{
+			if (Value == "int") Type->DataType = NumericTypeT::DataTypeT::Int;
+			else if (Value == "uint") Type->DataType = NumericTypeT::DataTypeT::UInt;
+			else if (Value == "float") Type->DataType = NumericTypeT::DataTypeT::Float;
+			else if (Value == "double") Type->DataType = NumericTypeT::DataTypeT::Double;
+			else throw ConstructionErrorT() << "Unknown numeric data type '" << Value << "' at " << Here().AsString();
+		});
+	});
+
+	// Groups
+	Kind(Object, KeyGroup, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Group = new GroupT(Here());
+		Set(Out, Group);
+		Statements(Object, Group->Statements);
+	});
+
+	Kind(Object, KeyBlock, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Block = new BlockT(Here());
+		Set(Out, Block);
+		Statements(Object, Block->Statements);
+	});
+
+	Kind(Object, KeyElement, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Element = new ElementT(Here());
+		Set(Out, Element);
+		Field(Object, KeyBase, Element->Base);
+		Field(Object, KeyKey, Element->Key);
+		// Shorthand for a literal key
+		Object.String(KeyName, [Element](std::string &&Value) { Element->Name = SymbolT(Value); });
+	});
+
+	// Type manipulations
+	Kind(Object, KeyDynamic, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Dynamic = new AsDynamicTypeT(Here());
+		Set(Out, Dynamic);
+		Field(Object, KeyType, Dynamic->Type);
+	});
+
+	// Statements
+	Kind(Object, KeyAssignment, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Assignment = new AssignmentT(Here());
+		Set(Out, Assignment);
+		Field(Object, KeyLeft, Assignment->Left);
+		Field(Object, KeyRight, Assignment->Right);
+	});
+
+	// Operations
+	Kind(Object, KeyBinary, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Operation = new BinaryOperationT(Here());
+		Set(Out, Operation);
+		Object.String(KeyOperator, [this, Operation](std::string &&Value)
+		{
+			auto Found = std::find(OperatorNames.begin(), OperatorNames.end(), Value);
+			if (Found == OperatorNames.end()) 
+				throw ConstructionErrorT() << "Unknown operator " << Value << " at " << Here().AsString();
+			Operation->Operator = static_cast<BinaryOperationT::OperatorT>(Found - OperatorNames.begin());
+		});
+		Field(Object, KeyLeft, Operation->Left);
+		Field(Object, KeyRight, Operation->Right);
+	});
+
+	// Functions
+	Kind(Object, KeyFunctionType, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Type = new FunctionTypeT(Here());
+		Set(Out, Type);
+		Object.UInt(KeyId, [Type](uint64_t Value) { Type->ID = Value; });
+		Object.Bool(KeyConstant, [Type](bool Value) { Type->Constant = Value; });
+		Object.Bool(KeyStatic, [Type](bool Value) { Type->Static = Value; });
+		Field(Object, KeySignature, Type->Signature);
+	});
+
+	Kind(Object, KeyCall, [this, &Out](Serial::ReadObjectT &Object)
+	{
+		auto Call = new CallT(Here());
+		Set(Out, Call);
+		Field(Object, KeyFunction, Call->Function);
+		Field(Object, KeyInput, Call->Input);
+	});
+}
+
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Entry points
+template <typename FeedT> static AtomT LoadWith(std::string const &Filename, FeedT const &Feed)
+{
+	LoaderT Loader(Filename);
+	AtomT Out;
+	Serial::ReadT Reader([&](Serial::ReadObjectT &Object) { Loader.Module(Object, Out); });
+	Loader.Reader = &Reader;
+	Feed(Reader);
+	return Out;
+}
+
+AtomT Load(std::istream &Input, std::string const &Filename)
+{
+	return LoadWith(Filename, [&](Serial::ReadT &Reader)
+	{
+		std::vector<char> Buffer(Serial::ReadT::DefaultBufferSize);
+		while (Input)
+		{
+			Input.read(&Buffer[0], Buffer.size());
+			if (Input.gcount() > 0) Reader.Parse(&Buffer[0], Input.gcount());
+		}
+		if (Input.bad()) throw ConstructionErrorT() << "Error reading " << Filename;
+		Reader.Finish();
+	});
+}
+
+AtomT Load(std::string const &Filename, size_t BufferSize)
+{
+	if (Filename == "-") 
+		return LoadWith("<stdin>", [&](Serial::ReadT &Reader) { Reader.ParseDescriptor(0, BufferSize); });
+	return LoadWith(Filename, [&](Serial::ReadT &Reader) { Reader.ParseFile(Filename, BufferSize); });
+}
+
+}
+
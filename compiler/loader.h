@@ -0,0 +1,37 @@
+#ifndef loader_h
+#define loader_h
+
+#include "core.h"
+
+namespace Core
+{
+
+//================================================================================================================
+// JSON syntax tree loading
+/*
+Every node is an object with a single key naming its kind, mapping to an object with the node's fields:
+
+	{"assignment": {"left": {"element": {"name": "utf8:a"}}, "right": {"int": {"value": 4}}}}
+
+The document itself describes a module:
+
+	{"name": "utf8:hello", "entry": true, "top": {"group": {"statements": [...]}}}
+
+Optionally, "evaluation_steps" and "evaluation_bytes" override the module's EvaluationBudgetT limits for calls 
+evaluated at compile time.
+
+Nodes are built as the parser produces events, so no document tree is held in memory.  Documents written with 
+Serial's binary format (Serial::FormatT::Binary) are detected and read the same way, and are much cheaper to parse.
+
+Node positions record the file and the byte offset of the node in the document.
+*/
+
+// Throws ConstructionErrorT on malformed input.  Files are mapped if possible, otherwise (like "-" for stdin) read 
+// BufferSize bytes at a time.
+AtomT Load(std::istream &Input, std::string const &Filename);
+AtomT Load(std::string const &Filename, size_t BufferSize = 1 << 16);
+
+}
+
+#endif
+
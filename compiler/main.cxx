@@ -1,11 +1,69 @@
 #include "core.h"
+#include "loader.h"
+#include "incremental.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace Core;
 
 //================================================================================================================
 // Main
-int main(int, char **)
+int main(int ArgumentCount, char **Arguments)
 {
+	if ((ArgumentCount >= 3) && (std::string(Arguments[2]) == "--watch"))
+	{
+		// Rebuilds whenever the file changes, reusing what it can from the previous build.  Everything shares one 
+		// arena, since restored values refer back to earlier builds.
+		ArenaT Arena;
+		ArenaT::ScopeT ArenaScope(Arena);
+		SessionT Session(llvm::getGlobalContext());
+		time_t Built = 0;
+		while (true)
+		{
+			struct stat Status;
+			if ((stat(Arguments[1], &Status) != 0) || (Status.st_mtime == Built))
+			{
+				sleep(1);
+				continue;
+			}
+			Built = Status.st_mtime;
+			try
+			{
+				auto Module = Load(Arguments[1]);
+				(*Module.As<ModuleT>())->CollectBytes = 64 << 20;
+				auto Stats = Session.Build(Module);
+				std::cerr << Stats.Simplified << " statements simplified, " << Stats.Restored << " restored, " << 
+					Stats.Erased << " functions erased" << std::endl;
+			}
+			catch (ConstructionErrorT const &Error)
+			{
+				std::cerr << Error << std::endl;
+			}
+		}
+	}
+	
+	if (ArgumentCount >= 2)
+	{
+		try
+		{
+			ArenaT Arena;
+			ArenaT::ScopeT ArenaScope(Arena);
+			auto Module = Load(Arguments[1]);
+			(*Module.As<ModuleT>())->CollectBytes = 64 << 20;
+			SimplifyEngineT::Run({llvm::getGlobalContext(), {}, {}, {}, HARDPOSITION, true}, Module);
+			// Drops the whole tree at once and clears Module, rather than freeing it node by node when it goes out of 
+			// scope
+			Arena.Release();
+		}
+		catch (ConstructionErrorT const &Error)
+		{
+			std::cerr << Error << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+	
 	//llvm::ReturnInst::Create(LLVM, Block);
 	/*auto &LLVM = llvm::getGlobalContext();
 	auto Module = new llvm::Module("asdf", LLVM);
@@ -48,7 +106,7 @@ int main(int, char **)
 	auto MakeElement_ = [&](PositionT const Position, std::string const &Key)
 	{
 		auto Out = new ElementT(Position);
-		Out->Key = MakeString_(Position, Key);
+		Out->Name = SymbolT(Key);
 		return Out;
 	};
 	#define MakeElement(...) MakeElement_(HARDPOSITION, __VA_ARGS__)
@@ -231,7 +289,7 @@ int main(int, char **)
 		MakeAssignment("output",
 			MakeInt(0))
 	}));
-	Module->Simplify({llvm::getGlobalContext(), {}, {}, {}, HARDPOSITION, true});
+	SimplifyEngineT::Run({llvm::getGlobalContext(), {}, {}, {}, HARDPOSITION, true}, Module);
 	/*MainGroup->Statements.push_back(
 		MakeAssignment("a",
 			MakeImplement(
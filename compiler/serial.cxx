@@ -1,108 +1,644 @@
 #include "serial.h"
 
 #include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <clocale>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits>
 
 #include "extrastandard.h"
-#include "math.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 static char const StringPrefix[] = "utf8:";
 static char const BinaryPrefix[] = "alpha16:";
+static char const Base64Prefix[] = "base64:";
 
 static std::vector<char> ToString(std::string const &In)
 {
 	std::vector<char> Out;
-	Out.resize(5 + In.length());
+	Out.resize(sizeof(StringPrefix) - 1 + In.length());
 	memcpy(&Out[0], StringPrefix, sizeof(StringPrefix) - 1);
 	memcpy(&Out[sizeof(StringPrefix) - 1], In.c_str(), In.length());
 	return Out;
 }
 
-static std::vector<char> ToBinary(uint8_t const *Bytes, size_t const Length)
+//----------------------------------------------------------------------------------------------------------------
+// Alpha16: each byte is two letters, 'a' + high nibble then 'a' + low nibble
+static void EncodeAlpha16(uint8_t const *In, size_t Length, char *Out)
+{
+	size_t Index = 0;
+#if defined(__AVX2__)
+	{
+		__m256i const Mask = _mm256_set1_epi8(0x0f), Base = _mm256_set1_epi8('a');
+		for (; Index + 32 <= Length; Index += 32)
+		{
+			__m256i const Bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(In + Index));
+			__m256i const High = _mm256_add_epi8(_mm256_and_si256(_mm256_srli_epi16(Bytes, 4), Mask), Base);
+			__m256i const Low = _mm256_add_epi8(_mm256_and_si256(Bytes, Mask), Base);
+			// Unpacking interleaves within each 128 bit lane, so the halves are swapped back into order
+			__m256i const First = _mm256_unpacklo_epi8(High, Low), Second = _mm256_unpackhi_epi8(High, Low);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(Out + Index * 2), _mm256_permute2x128_si256(First, Second, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(Out + Index * 2 + 32), _mm256_permute2x128_si256(First, Second, 0x31));
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	{
+		__m128i const Mask = _mm_set1_epi8(0x0f), Base = _mm_set1_epi8('a');
+		for (; Index + 16 <= Length; Index += 16)
+		{
+			__m128i const Bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(In + Index));
+			__m128i const High = _mm_add_epi8(_mm_and_si128(_mm_srli_epi16(Bytes, 4), Mask), Base);
+			__m128i const Low = _mm_add_epi8(_mm_and_si128(Bytes, Mask), Base);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(Out + Index * 2), _mm_unpacklo_epi8(High, Low));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(Out + Index * 2 + 16), _mm_unpackhi_epi8(High, Low));
+		}
+	}
+#endif
+	for (; Index < Length; ++Index)
+	{
+		Out[Index * 2] = (In[Index] >> 4) + 'a';
+		Out[Index * 2 + 1] = (In[Index] & 0xf) + 'a';
+	}
+}
+
+// In has Length * 2 characters
+static bool DecodeAlpha16(char const *In, size_t Length, uint8_t *Out)
+{
+	size_t Index = 0;
+#if defined(__AVX2__)
+	{
+		__m256i const Base = _mm256_set1_epi8('a'), Invalid = _mm256_set1_epi8(static_cast<char>(0xf0)), 
+			LowByte = _mm256_set1_epi16(0x00ff);
+		for (; Index + 32 <= Length; Index += 32)
+		{
+			// Anything outside 'a'-'p' lands outside 0-15 after subtracting, with wrapping
+			__m256i const First = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(In + Index * 2)), Base);
+			__m256i const Second = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(In + Index * 2 + 32)), Base);
+			if (!_mm256_testz_si256(_mm256_or_si256(First, Second), Invalid)) return false;
+			// Each 16 bit lane holds a high nibble then a low nibble
+			__m256i const FirstBytes = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(First, LowByte), 4), _mm256_srli_epi16(First, 8));
+			__m256i const SecondBytes = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(Second, LowByte), 4), _mm256_srli_epi16(Second, 8));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(Out + Index), 
+				_mm256_permute4x64_epi64(_mm256_packus_epi16(FirstBytes, SecondBytes), 0xd8));
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	{
+		__m128i const Base = _mm_set1_epi8('a'), Invalid = _mm_set1_epi8(static_cast<char>(0xf0)), 
+			Zero = _mm_setzero_si128(), LowByte = _mm_set1_epi16(0x00ff);
+		for (; Index + 16 <= Length; Index += 16)
+		{
+			__m128i const First = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(In + Index * 2)), Base);
+			__m128i const Second = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(In + Index * 2 + 16)), Base);
+			__m128i const Bad = _mm_and_si128(_mm_or_si128(First, Second), Invalid);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(Bad, Zero)) != 0xffff) return false;
+			__m128i const FirstBytes = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(First, LowByte), 4), _mm_srli_epi16(First, 8));
+			__m128i const SecondBytes = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(Second, LowByte), 4), _mm_srli_epi16(Second, 8));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(Out + Index), _mm_packus_epi16(FirstBytes, SecondBytes));
+		}
+	}
+#endif
+	for (; Index < Length; ++Index)
+	{
+		uint8_t const High = In[Index * 2] - 'a', Low = In[Index * 2 + 1] - 'a';
+		if ((High | Low) & 0xf0) return false;
+		Out[Index] = (High << 4) | Low;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Base64: standard alphabet with padding, for large payloads where alpha16's doubling hurts
+static char const Base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void EncodeBase64(uint8_t const *In, size_t Length, char *Out)
+{
+	size_t Index = 0;
+	for (; Index + 3 <= Length; Index += 3, Out += 4)
+	{
+		uint32_t const Group = (In[Index] << 16) | (In[Index + 1] << 8) | In[Index + 2];
+		Out[0] = Base64Alphabet[(Group >> 18) & 0x3f];
+		Out[1] = Base64Alphabet[(Group >> 12) & 0x3f];
+		Out[2] = Base64Alphabet[(Group >> 6) & 0x3f];
+		Out[3] = Base64Alphabet[Group & 0x3f];
+	}
+	if (Index == Length) return;
+	uint32_t const Group = (In[Index] << 16) | ((Index + 1 < Length) ? (In[Index + 1] << 8) : 0);
+	Out[0] = Base64Alphabet[(Group >> 18) & 0x3f];
+	Out[1] = Base64Alphabet[(Group >> 12) & 0x3f];
+	Out[2] = (Index + 1 < Length) ? Base64Alphabet[(Group >> 6) & 0x3f] : '=';
+	Out[3] = '=';
+}
+
+static bool Base64DecodedLength(StringViewT const &In, size_t &Out)
+{
+	if (In.size() % 4 != 0) return false;
+	Out = In.size() / 4 * 3;
+	if (!In.empty() && (In[In.size() - 1] == '=')) --Out;
+	if ((In.size() >= 2) && (In[In.size() - 2] == '=')) --Out;
+	return true;
+}
+
+static bool DecodeBase64(StringViewT const &In, uint8_t *Out)
+{
+	static std::array<uint8_t, 256> const Values = [](void)
+	{
+		std::array<uint8_t, 256> Out;
+		Out.fill(0xff);
+		for (uint8_t Index = 0; Index < 64; ++Index) Out[static_cast<uint8_t>(Base64Alphabet[Index])] = Index;
+		return Out;
+	}();
+	size_t Length;
+	if (!Base64DecodedLength(In, Length)) return false;
+	size_t const Full = Length / 3;
+	for (size_t Index = 0; Index < Full; ++Index)
+	{
+		uint8_t const A = Values[static_cast<uint8_t>(In[Index * 4])], B = Values[static_cast<uint8_t>(In[Index * 4 + 1])],
+			C = Values[static_cast<uint8_t>(In[Index * 4 + 2])], D = Values[static_cast<uint8_t>(In[Index * 4 + 3])];
+		if ((A | B | C | D) & 0xc0) return false;
+		uint32_t const Group = (A << 18) | (B << 12) | (C << 6) | D;
+		Out[Index * 3] = Group >> 16;
+		Out[Index * 3 + 1] = (Group >> 8) & 0xff;
+		Out[Index * 3 + 2] = Group & 0xff;
+	}
+	size_t const Remainder = Length - Full * 3;
+	if (Remainder == 0) return true;
+	char const *Tail = In.data() + Full * 4;
+	uint8_t const A = Values[static_cast<uint8_t>(Tail[0])], B = Values[static_cast<uint8_t>(Tail[1])],
+		C = (Remainder == 2) ? Values[static_cast<uint8_t>(Tail[2])] : 0;
+	if ((A | B | C) & 0xc0) return false;
+	uint32_t const Group = (A << 18) | (B << 12) | (C << 6);
+	Out[Full * 3] = Group >> 16;
+	if (Remainder == 2) Out[Full * 3 + 1] = (Group >> 8) & 0xff;
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Prefixed binary strings
+static std::vector<char> ToBinary(uint8_t const *Bytes, size_t const Length, Serial::BinaryFormatT Format)
 {
 	std::vector<char> Out;
-	Out.resize(5 + Length * 2);
-	memcpy(&Out[0], BinaryPrefix, sizeof(BinaryPrefix) - 1);
-	for (size_t Index = 0; Index < Length; ++Index)
+	switch (Format)
 	{
-		Out[sizeof(BinaryPrefix) - 1 + Index * 2] = (Bytes[Index] >> 8) + 'a';
-		Out[sizeof(BinaryPrefix) - 1 + Index * 2 + 1] = (Bytes[Index] & 0xf) + 'a';
+		case Serial::BinaryFormatT::Alpha16:
+			Out.resize(sizeof(BinaryPrefix) - 1 + Length * 2);
+			memcpy(&Out[0], BinaryPrefix, sizeof(BinaryPrefix) - 1);
+			EncodeAlpha16(Bytes, Length, &Out[sizeof(BinaryPrefix) - 1]);
+			break;
+		case Serial::BinaryFormatT::Base64:
+			Out.resize(sizeof(Base64Prefix) - 1 + (Length + 2) / 3 * 4);
+			memcpy(&Out[0], Base64Prefix, sizeof(Base64Prefix) - 1);
+			EncodeBase64(Bytes, Length, &Out[sizeof(Base64Prefix) - 1]);
+			break;
+		default: Assert(false); break;
 	}
 	return Out;
 }
 
-static std::vector<uint8_t> FromBinary(std::string const &In)
+static bool IsBinary(StringViewT const &In) { return In.starts_with(BinaryPrefix) || In.starts_with(Base64Prefix); }
+
+// In must pass IsBinary
+static bool BinaryLength(StringViewT const &In, size_t &Out)
+{
+	if (In.starts_with(BinaryPrefix))
+	{
+		auto Data = In.substr(sizeof(BinaryPrefix) - 1);
+		if (Data.size() % 2 != 0) return false;
+		Out = Data.size() / 2;
+		return true;
+	}
+	return Base64DecodedLength(In.substr(sizeof(Base64Prefix) - 1), Out);
+}
+
+// Out must have room for BinaryLength bytes
+static bool DecodeBinary(StringViewT const &In, uint8_t *Out)
 {
-	if (In.size() % 2 != 0) return {};
-	std::vector<uint8_t> Out(In.size() / 2);
-	for (size_t Position = 0; Position < In.size() / 2; ++Position)
+	if (In.starts_with(BinaryPrefix))
 	{
-		if (!RangeT<char>('a', 16).Contains(In[Position * 2])) return {};
-		if (!RangeT<char>('a', 16).Contains(In[Position * 2 + 1])) return {};
-		Out[Position] = 
-			((In[Position * 2] - 'a') << 8) +
-			(In[Position * 2 + 1] - 'a');
+		auto Data = In.substr(sizeof(BinaryPrefix) - 1);
+		return DecodeAlpha16(Data.data(), Data.size() / 2, Out);
 	}
-	return Out;
+	return DecodeBase64(In.substr(sizeof(Base64Prefix) - 1), Out);
 }
 
+// Locale-free number parsing.  Yajl has already checked the JSON number syntax, but the checks are repeated so 
+// nothing is assumed about the source.
+struct DecimalT
+{
+	bool Negative = false;
+	uint64_t Mantissa = 0; // As many leading digits as fit
+	int64_t Exponent = 0;
+	bool Truncated = false; // Nonzero digits were dropped from the mantissa
+};
+
+static bool IsDigit(char Value) { return (Value >= '0') && (Value <= '9'); }
+
+static bool Decompose(StringViewT const &Source, DecimalT &Out)
+{
+	auto Next = Source.begin(), End = Source.end();
+	auto Digit = [&](void)
+	{
+		uint8_t Value = *Next - '0';
+		if (Out.Mantissa <= (std::numeric_limits<uint64_t>::max() - Value) / 10) 
+		{
+			Out.Mantissa = Out.Mantissa * 10 + Value;
+			return true;
+		}
+		if (Value != 0) Out.Truncated = true;
+		return false;
+	};
+	
+	if ((Next != End) && (*Next == '-')) { Out.Negative = true; ++Next; }
+	if ((Next == End) || !IsDigit(*Next)) return false;
+	for (; (Next != End) && IsDigit(*Next); ++Next)
+		if (!Digit()) ++Out.Exponent;
+	if ((Next != End) && (*Next == '.'))
+	{
+		++Next;
+		if ((Next == End) || !IsDigit(*Next)) return false;
+		for (; (Next != End) && IsDigit(*Next); ++Next)
+			if (Digit()) --Out.Exponent;
+	}
+	if ((Next != End) && ((*Next == 'e') || (*Next == 'E')))
+	{
+		++Next;
+		bool NegativeExponent = false;
+		if ((Next != End) && ((*Next == '-') || (*Next == '+'))) { NegativeExponent = *Next == '-'; ++Next; }
+		if ((Next == End) || !IsDigit(*Next)) return false;
+		int64_t Exponent = 0;
+		for (; (Next != End) && IsDigit(*Next); ++Next)
+			if (Exponent < 100000) Exponent = Exponent * 10 + (*Next - '0'); // Saturate, far past any representable value
+		Out.Exponent += NegativeExponent ? -Exponent : Exponent;
+	}
+	return Next == End;
+}
+
+// Integers may use fractions and exponents as long as the value is whole, like 1.5e3
+static bool ParseMagnitude(StringViewT const &Source, bool &Negative, uint64_t &Out)
+{
+	DecimalT Decimal;
+	if (!Decompose(Source, Decimal) || Decimal.Truncated) return false;
+	Negative = Decimal.Negative;
+	Out = Decimal.Mantissa;
+	if (Out == 0) return true;
+	for (; Decimal.Exponent > 0; --Decimal.Exponent)
+	{
+		if (Out > std::numeric_limits<uint64_t>::max() / 10) return false;
+		Out *= 10;
+	}
+	for (; Decimal.Exponent < 0; ++Decimal.Exponent)
+	{
+		if (Out % 10 != 0) return false;
+		Out /= 10;
+	}
+	return true;
+}
+
+static bool ParseInt(StringViewT const &Source, int64_t &Out)
+{
+	bool Negative;
+	uint64_t Magnitude;
+	if (!ParseMagnitude(Source, Negative, Magnitude)) return false;
+	uint64_t const Limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+	if (Magnitude > Limit + (Negative ? 1 : 0)) return false;
+	Out = Negative ? static_cast<int64_t>(0 - Magnitude) : static_cast<int64_t>(Magnitude);
+	return true;
+}
+
+static bool ParseUInt(StringViewT const &Source, uint64_t &Out)
+{
+	bool Negative;
+	if (!ParseMagnitude(Source, Negative, Out)) return false;
+	return !Negative || (Out == 0);
+}
+
+// Values whose mantissa and power of ten are both exact in RealT are computed directly, which rounds once.  Everything 
+// else goes to the C library, which rounds correctly; the "C" locale keeps the decimal point a '.'.  Results that 
+// round to infinity are out of range.
+template <typename RealT> struct RealTraitsT;
+
+template <> struct RealTraitsT<float>
+{
+	static constexpr uint64_t MaxExactMantissa = 1ull << 24;
+	static constexpr int MaxExactExponent = 10;
+	static float Library(char const *Text, locale_t Locale) { return strtof_l(Text, nullptr, Locale); }
+};
+
+template <> struct RealTraitsT<double>
+{
+	static constexpr uint64_t MaxExactMantissa = 1ull << 53;
+	static constexpr int MaxExactExponent = 22;
+	static double Library(char const *Text, locale_t Locale) { return strtod_l(Text, nullptr, Locale); }
+};
+
+template <typename RealT> static bool ParseReal(StringViewT const &Source, RealT &Out)
+{
+	typedef RealTraitsT<RealT> TraitsT;
+	DecimalT Decimal;
+	if (!Decompose(Source, Decimal)) return false;
+	RealT Value;
+	if (!Decimal.Truncated && 
+		(Decimal.Mantissa <= TraitsT::MaxExactMantissa) && 
+		(Decimal.Exponent >= -TraitsT::MaxExactExponent) && 
+		(Decimal.Exponent <= TraitsT::MaxExactExponent))
+	{
+		static RealT const Exact[] = 
+			{1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 
+			1e19, 1e20, 1e21, 1e22};
+		RealT const Mantissa = static_cast<RealT>(Decimal.Mantissa);
+		Value = Decimal.Exponent < 0 ? Mantissa / Exact[-Decimal.Exponent] : Mantissa * Exact[Decimal.Exponent];
+		if (Decimal.Negative) Value = -Value;
+	}
+	else
+	{
+		static locale_t const CLocale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+		// Decompose checked the syntax, so the library sees a plain decimal
+		std::string const Text(Source.data(), Source.size());
+		Value = TraitsT::Library(Text.c_str(), CLocale);
+	}
+	if (std::isinf(Value)) return false;
+	Out = Value;
+	return true;
+}
+
+static bool ParseFloat(StringViewT const &Source, float &Out) { return ParseReal(Source, Out); }
+
+static bool ParseDouble(StringViewT const &Source, double &Out) { return ParseReal(Source, Out); }
+
 namespace Serial
 {
 
+//================================================================================================================
+// Binary documents
+/*
+A binary document is the magic header followed by the same events a JSON document produces, each a tag byte and 
+a payload:
+
+	False, True, Object, Array, Close: no payload
+	Int: zigzag varint
+	UInt: varint
+	Float: little endian IEEE double
+	String, Binary, Key: varint byte length, then the bytes (strings have no "utf8:" prefix)
+
+Varints are little endian base 128.  Payloads are never escaped, so readers can pass views straight into the input.
+*/
+static char const BinaryMagic[] = {'\0', 'k', 'k', '\1'}; // JSON can't start with a null
+
+enum struct BinaryTagT : uint8_t
+{
+	False,
+	True,
+	Int,
+	UInt,
+	Float,
+	String,
+	Binary,
+	Key,
+	Object,
+	Array,
+	Close
+};
+
+size_t const MaxVarintLength = 10;
+
 //================================================================================================================
 // Writing
 
 //----------------------------------------------------------------------------------------------------------------
-// Array writer
-WriteArrayT::WriteArrayT(WriteArrayT &&Other) : Base(Other.Base) { Other.Base = nullptr; }
+// Buffered output
+OutputT::OutputT(int Descriptor, FormatT Format, size_t BufferSize) : 
+	Descriptor(Descriptor), Buffer(BufferSize), Used(0), Generator(CreateGenerator(Format)) 
+	{ Assert(BufferSize > 0); }
+
+OutputT::OutputT(SinkT const &Sink, FormatT Format, size_t BufferSize) : 
+	Descriptor(-1), Sink(Sink), Buffer(BufferSize), Used(0), Generator(CreateGenerator(Format)) 
+	{ Assert(BufferSize > 0); }
 
-WriteArrayT::~WriteArrayT(void) { if (Base) yajl_gen_array_close(Base); }
+OutputT::~OutputT(void) 
+{ 
+	try { Flush(); } 
+	catch (...) {} // Call Flush first to see errors
+}
+
+void OutputT::Write(char const *Data, size_t Length)
+{
+	if (Length <= Buffer.size() - Used)
+	{
+		memcpy(&Buffer[Used], Data, Length);
+		Used += Length;
+	}
+	else if (Length >= Buffer.size()) Send(Data, Length);
+	else
+	{
+		Send(nullptr, 0);
+		memcpy(&Buffer[0], Data, Length);
+		Used = Length;
+	}
+}
 
-void WriteArrayT::Bool(bool const &Value) { Assert(Base); if (Base) yajl_gen_bool(Base, Value); }
+void OutputT::Flush(void) { Send(nullptr, 0); }
+
+void OutputT::Send(char const *Extra, size_t ExtraLength)
+{
+	if (Sink)
+	{
+		if (Used) Sink(Buffer.data(), Used);
+		Used = 0;
+		if (ExtraLength) Sink(Extra, ExtraLength);
+		return;
+	}
+	
+	// Buffered and extra data go out in one call where possible
+	iovec Parts[2] = {{Buffer.data(), Used}, {const_cast<char *>(Extra), ExtraLength}};
+	size_t Index = 0;
+	while (true)
+	{
+		while ((Index < 2) && (Parts[Index].iov_len == 0)) ++Index;
+		if (Index == 2) break;
+		auto Count = writev(Descriptor, Parts + Index, 2 - Index);
+		if (Count < 0)
+		{
+			if (errno == EINTR) continue;
+			throw ConstructionErrorT() << "Error writing output: " << strerror(errno);
+		}
+		for (size_t Written = Count; Written > 0; )
+		{
+			auto Take = std::min(Written, Parts[Index].iov_len);
+			Parts[Index].iov_base = reinterpret_cast<char *>(Parts[Index].iov_base) + Take;
+			Parts[Index].iov_len -= Take;
+			Written -= Take;
+			if (Parts[Index].iov_len == 0) ++Index;
+		}
+	}
+	Used = 0;
+}
 
-void WriteArrayT::Int(int64_t const &Value) { Assert(Base); if (Base) yajl_gen_integer(Base, Value); }
+//----------------------------------------------------------------------------------------------------------------
+// Generators
+GeneratorT::GeneratorT(void) : Output(nullptr) {}
 
-void WriteArrayT::UInt(uint64_t const &Value) { Assert(Base); if (Base) yajl_gen_integer(Base, Value); }
+GeneratorT::~GeneratorT(void) {}
 
-void WriteArrayT::Float(float const &Value) { Assert(Base); if (Base) yajl_gen_double(Base, Value); }
+namespace
+{
 
-void WriteArrayT::String(std::string const &Value) 
+struct JSONGeneratorT : GeneratorT
 {
-	Assert(Base); 
-	if (Base) 
+	yajl_gen Base;
+	bool Used;
+	
+	JSONGeneratorT(void) : Base(yajl_gen_alloc(nullptr)), Used(false)
+		{ yajl_gen_config(Base, yajl_gen_print_callback, &JSONGeneratorT::Print, this); }
+	~JSONGeneratorT(void) { yajl_gen_free(Base); }
+	
+	static void Print(void *Context, char const *Data, size_t Length) 
+		{ reinterpret_cast<JSONGeneratorT *>(Context)->Output->Write(Data, Length); }
+	
+	void Start(void) override
+	{
+		// Documents are separated by newlines
+		if (Used) yajl_gen_reset(Base, "\n");
+		Used = true;
+	}
+	void Bool(bool Value) override { yajl_gen_bool(Base, Value); }
+	void Int(int64_t Value) override { yajl_gen_integer(Base, Value); }
+	void UInt(uint64_t Value) override 
+	{ 
+		auto Text = std::to_string(Value);
+		yajl_gen_number(Base, Text.c_str(), Text.length()); 
+	}
+	void Real(double Value) override { yajl_gen_double(Base, Value); }
+	void String(std::string const &Value) override
 	{
 		auto Temp = ToString(Value);
 		yajl_gen_string(Base, reinterpret_cast<unsigned char *>(&Temp[0]), Temp.size()); 
 	}
+	void Binary(uint8_t const *Bytes, size_t Length, BinaryFormatT Format) override
+	{
+		auto Temp = ToBinary(Bytes, Length, Format);
+		yajl_gen_string(Base, reinterpret_cast<unsigned char *>(&Temp[0]), Temp.size()); 
+	}
+	void Key(std::string const &Key) override
+		{ yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length()); }
+	void ObjectOpen(void) override { yajl_gen_map_open(Base); }
+	void ObjectClose(void) override { yajl_gen_map_close(Base); }
+	void ArrayOpen(void) override { yajl_gen_array_open(Base); }
+	void ArrayClose(void) override { yajl_gen_array_close(Base); }
+};
+
+struct BinaryGeneratorT : GeneratorT
+{
+	void Tag(BinaryTagT Tag) { char const Byte = static_cast<char>(Tag); Output->Write(&Byte, 1); }
+	
+	// Tag and varint in one write
+	void Tag(BinaryTagT Tag, uint64_t Value)
+	{
+		char Header[1 + MaxVarintLength];
+		size_t Length = 0;
+		Header[Length++] = static_cast<char>(Tag);
+		while (Value >= 0x80)
+		{
+			Header[Length++] = static_cast<char>((Value & 0x7f) | 0x80);
+			Value >>= 7;
+		}
+		Header[Length++] = static_cast<char>(Value);
+		Output->Write(Header, Length);
+	}
+	
+	void Bytes(BinaryTagT Tag, char const *Data, size_t Length)
+	{
+		this->Tag(Tag, Length);
+		Output->Write(Data, Length);
+	}
+	
+	void Start(void) override { Output->Write(BinaryMagic, sizeof(BinaryMagic)); }
+	void Bool(bool Value) override { Tag(Value ? BinaryTagT::True : BinaryTagT::False); }
+	void Int(int64_t Value) override 
+		{ Tag(BinaryTagT::Int, (static_cast<uint64_t>(Value) << 1) ^ static_cast<uint64_t>(Value >> 63)); }
+	void UInt(uint64_t Value) override { Tag(BinaryTagT::UInt, Value); }
+	void Real(double Value) override
+	{
+		uint64_t Bits;
+		memcpy(&Bits, &Value, sizeof(Bits));
+		char Event[9];
+		Event[0] = static_cast<char>(BinaryTagT::Float);
+		for (size_t Index = 0; Index < 8; ++Index) Event[1 + Index] = static_cast<char>(Bits >> (Index * 8));
+		Output->Write(Event, sizeof(Event));
+	}
+	void String(std::string const &Value) override { Bytes(BinaryTagT::String, Value.c_str(), Value.length()); }
+	void Binary(uint8_t const *Bytes, size_t Length, BinaryFormatT Format) override
+		{ this->Bytes(BinaryTagT::Binary, reinterpret_cast<char const *>(Bytes), Length); }
+	void Key(std::string const &Key) override { Bytes(BinaryTagT::Key, Key.c_str(), Key.length()); }
+	void ObjectOpen(void) override { Tag(BinaryTagT::Object); }
+	void ObjectClose(void) override { Tag(BinaryTagT::Close); }
+	void ArrayOpen(void) override { Tag(BinaryTagT::Array); }
+	void ArrayClose(void) override { Tag(BinaryTagT::Close); }
+};
+
 }
 
-void WriteArrayT::Binary(uint8_t const *Bytes, size_t const Length) 
+GeneratorT *OutputT::CreateGenerator(FormatT Format)
 {
-	Assert(Base); 
-	if (Base) 
+	switch (Format)
 	{
-		auto Temp = ToBinary(Bytes, Length);
-		yajl_gen_string(Base, reinterpret_cast<unsigned char *>(&Temp[0]), Temp.size()); 
+		case FormatT::JSON: return new JSONGeneratorT;
+		case FormatT::Binary: return new BinaryGeneratorT;
+		default: Assert(false); return nullptr;
 	}
 }
 
+//----------------------------------------------------------------------------------------------------------------
+// Array writer
+WriteArrayT::WriteArrayT(WriteArrayT &&Other) : Base(Other.Base) { Other.Base = nullptr; }
+
+WriteArrayT::~WriteArrayT(void) { if (Base) Base->ArrayClose(); }
+
+void WriteArrayT::Bool(bool const &Value) { Assert(Base); if (Base) Base->Bool(Value); }
+
+void WriteArrayT::Int(int64_t const &Value) { Assert(Base); if (Base) Base->Int(Value); }
+
+void WriteArrayT::UInt(uint64_t const &Value) { Assert(Base); if (Base) Base->UInt(Value); }
+
+void WriteArrayT::Float(float const &Value) { Assert(Base); if (Base) Base->Real(Value); }
+
+void WriteArrayT::Double(double const &Value) { Assert(Base); if (Base) Base->Real(Value); }
+
+void WriteArrayT::String(std::string const &Value) { Assert(Base); if (Base) Base->String(Value); }
+
+void WriteArrayT::Binary(uint8_t const *Bytes, size_t const Length, BinaryFormatT Format) 
+	{ Assert(Base); if (Base) Base->Binary(Bytes, Length, Format); }
+
 WriteObjectT WriteArrayT::Object(void) { return WriteObjectT(Base); }
 
 WriteArrayT WriteArrayT::Array(void) { return WriteArrayT(Base); }
 
-WriteArrayT::WriteArrayT(yajl_gen Base) : Base(Base) { Assert(Base); if (Base) yajl_gen_array_open(Base); }
+WriteArrayT::WriteArrayT(GeneratorT *Base) : Base(Base) { Assert(Base); if (Base) Base->ArrayOpen(); }
 
 //----------------------------------------------------------------------------------------------------------------
 // Object writer
 WriteObjectT::WriteObjectT(WriteObjectT &&Other) : Base(Other.Base) { Other.Base = nullptr; }
 
-WriteObjectT::~WriteObjectT(void) { if (Base) yajl_gen_map_close(Base); }
+WriteObjectT::~WriteObjectT(void) { if (Base) Base->ObjectClose(); }
 
 void WriteObjectT::Bool(std::string const &Key, bool const &Value) 
 { 
 	if (Base) 
 	{
-		yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
-		yajl_gen_bool(Base, Value); 
+		Base->Key(Key);
+		Base->Bool(Value); 
 	} 
 	else Assert(false);
 }
@@ -111,8 +647,8 @@ void WriteObjectT::Int(std::string const &Key, int64_t const &Value)
 { 
 	if (Base) 
 	{
-		yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
-		yajl_gen_integer(Base, Value); 
+		Base->Key(Key);
+		Base->Int(Value); 
 	} 
 	else Assert(false);
 }
@@ -121,8 +657,8 @@ void WriteObjectT::UInt(std::string const &Key, uint64_t const &Value)
 { 
 	if (Base) 
 	{
-		yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
-		yajl_gen_integer(Base, Value); 
+		Base->Key(Key);
+		Base->UInt(Value); 
 	} 
 	else Assert(false);
 }
@@ -131,8 +667,18 @@ void WriteObjectT::Float(std::string const &Key, float const &Value)
 { 
 	if (Base) 
 	{
-		yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
-		yajl_gen_double(Base, Value); 
+		Base->Key(Key);
+		Base->Real(Value); 
+	} 
+	else Assert(false);
+}
+
+void WriteObjectT::Double(std::string const &Key, double const &Value)
+{ 
+	if (Base) 
+	{
+		Base->Key(Key);
+		Base->Real(Value); 
 	} 
 	else Assert(false);
 }
@@ -141,239 +687,519 @@ void WriteObjectT::String(std::string const &Key, std::string const &Value)
 { 
 	if (Base) 
 	{
-		yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
-		auto Temp = ToString(Value);
-		yajl_gen_string(Base, reinterpret_cast<unsigned char *>(&Temp[0]), Temp.size()); 
+		Base->Key(Key);
+		Base->String(Value); 
 	} 
 	else Assert(false);
 }
 
-void WriteObjectT::Binary(std::string const &Key, uint8_t const *Bytes, size_t const Length) 
+void WriteObjectT::Binary(std::string const &Key, uint8_t const *Bytes, size_t const Length, BinaryFormatT Format) 
 { 
 	if (Base) 
 	{
-		yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
-		auto Temp = ToBinary(Bytes, Length);
-		yajl_gen_string(Base, reinterpret_cast<unsigned char *>(&Temp[0]), Temp.size()); 
+		Base->Key(Key);
+		Base->Binary(Bytes, Length, Format); 
 	} 
 	else Assert(false);
 }
 
 WriteObjectT WriteObjectT::Object(std::string const &Key)
 { 
-	if (Base) yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
+	if (Base) Base->Key(Key);
 	else Assert(false);
 	return WriteObjectT(Base);
 }
 
 WriteArrayT WriteObjectT::Array(std::string const &Key)
 { 
-	if (Base) yajl_gen_string(Base, reinterpret_cast<unsigned char const *>(Key.c_str()), Key.length());
+	if (Base) Base->Key(Key);
 	else Assert(false);
 	return WriteArrayT(Base);
 }
 
-WriteObjectT::WriteObjectT(yajl_gen Base) : Base(Base) { Assert(Base); if (Base) yajl_gen_map_open(Base); }
+WriteObjectT::WriteObjectT(GeneratorT *Base) : Base(Base) { Assert(Base); if (Base) Base->ObjectOpen(); }
 
 //----------------------------------------------------------------------------------------------------------------
 // Writing start point
-WriteT::WriteT(void) : WriteObjectT(yajl_gen_alloc(nullptr))
+static GeneratorT *StartDocument(OutputT &Output, GeneratorT *Generator)
+{
+	Generator->Output = &Output;
+	Generator->Start();
+	return Generator;
+}
+
+WriteT::WriteT(OutputT &Output) : WriteObjectT(StartDocument(Output, Output.Generator.get())), Output(&Output), Owned(false)
+{
+}
+
+WriteT::WriteT(SinkT const &Sink, FormatT Format) : WriteT(*new OutputT(Sink, Format))
 {
+	Owned = true;
 }
 
 WriteT::~WriteT(void)
 {
-	yajl_gen_map_close(Base);
-	yajl_gen_free(Base);
+	Base->ObjectClose();
 	Base = nullptr;
+	if (Owned) delete Output;
 }
 
 //================================================================================================================
 // Reading
 
-ReadNestableT::~ReadNestableT(void) {}
-
 //----------------------------------------------------------------------------------------------------------------
-// Nested array reader
-ReadArrayT::~ReadArrayT(void) { if (DestructorCallback) DestructorCallback(); }
+// Key tables
+KeyTableT::KeyTableT(std::initializer_list<char const *> Keys) : Keys(Keys.begin(), Keys.end()), Seed(0)
+{
+	AssertLT(this->Keys.size(), std::numeric_limits<KeyIDT>::max());
+	{
+		auto Sorted = this->Keys;
+		std::sort(Sorted.begin(), Sorted.end());
+		Assert(std::adjacent_find(Sorted.begin(), Sorted.end()) == Sorted.end()); // Duplicate keys never stop colliding
+	}
+	
+	// Search for a seed that gives every key its own slot, growing the table if none turn up
+	size_t Size = 1;
+	while (Size < this->Keys.size() * 2) Size <<= 1;
+	while (true)
+	{
+		for (Seed = 0; Seed < 64; ++Seed)
+		{
+			Slots.assign(Size, 0);
+			bool Collided = false;
+			for (size_t Index = 0; Index < this->Keys.size(); ++Index)
+			{
+				auto &Slot = Slots[Hash(this->Keys[Index]) & (Size - 1)];
+				if (Slot) { Collided = true; break; }
+				Slot = Index + 1;
+			}
+			if (!Collided) return;
+		}
+		Size <<= 1;
+	}
+}
 
-void ReadArrayT::Bool(LooseBoolCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<BoolCallbackT>(Callback); }
-void ReadArrayT::Int(LooseIntCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<IntCallbackT>(Callback); }
-void ReadArrayT::UInt(LooseUIntCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<UIntCallbackT>(Callback); }
-void ReadArrayT::Float(LooseFloatCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<FloatCallbackT>(Callback); }
-void ReadArrayT::String(LooseStringCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<StringCallbackT>(Callback); }
-void ReadArrayT::Binary(LooseBinaryCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<BinaryCallbackT>(Callback); }
-void ReadArrayT::Object(LooseObjectCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<ObjectCallbackT>(Callback); }
-void ReadArrayT::Array(LooseArrayCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<ArrayCallbackT>(Callback); }
+OptionalT<KeyIDT> KeyTableT::Find(StringViewT Key) const
+{
+	auto Slot = Slots[Hash(Key) & (Slots.size() - 1)];
+	if (!Slot) return {};
+	if (StringViewT(Keys[Slot - 1]) != Key) return {};
+	return KeyIDT(Slot - 1);
+}
 
-void ReadArrayT::Destructor(std::function<void(void)> const &Callback) { Assert(!DestructorCallback); DestructorCallback = Callback; }
+KeyIDT KeyTableT::operator [](StringViewT Key) const
+{
+	auto Out = Find(Key);
+	Assert(Out);
+	return *Out;
+}
 
-bool ReadArrayT::Bool(bool Value) 
-	{ if (Callback.Is<BoolCallbackT>()) Callback.Get<BoolCallbackT>()(Value); return true; }
-	
-bool ReadArrayT::Number(std::string const &Source)
+size_t KeyTableT::size(void) const { return Keys.size(); }
+
+uint32_t KeyTableT::Hash(StringViewT Key) const
+{
+	// FNV-1a
+	uint32_t Out = 2166136261u ^ (Seed * 0x9e3779b9u);
+	for (auto Byte : Key)
+	{
+		Out ^= static_cast<uint8_t>(Byte);
+		Out *= 16777619u;
+	}
+	return Out ^ (Out >> 15);
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Base reader
+ReadNestableT::~ReadNestableT(void) {}
+
+bool ReadNestableT::DispatchNumber(StringViewT Source, CallbackT *Callback)
 {
-	// TODO handle scientific/eX notation somehow?
-	if (Callback.Is<IntCallbackT>())
+	if (!Callback) return true;
+	if (Callback->Is<IntCallbackT>())
 	{
 		int64_t Value;
-		if (!(StringT(Source) >> Value)) return false;
-		Callback.Get<IntCallbackT>()(Value);
+		if (!ParseInt(Source, Value)) return false;
+		Callback->Get<IntCallbackT>()(Value);
 	}
-	else if (Callback.Is<UIntCallbackT>())
+	else if (Callback->Is<UIntCallbackT>())
 	{
 		uint64_t Value;
-		if (!(StringT(Source) >> Value)) return false;
-		Callback.Get<UIntCallbackT>()(Value);
+		if (!ParseUInt(Source, Value)) return false;
+		Callback->Get<UIntCallbackT>()(Value);
 	}
-	else if (Callback.Is<FloatCallbackT>())
+	else if (Callback->Is<FloatCallbackT>())
 	{
 		float Value;
-		if (!(StringT(Source) >> Value)) return false;
-		Callback.Get<FloatCallbackT>()(Value);
+		if (!ParseFloat(Source, Value)) return false;
+		Callback->Get<FloatCallbackT>()(Value);
+	}
+	else if (Callback->Is<DoubleCallbackT>())
+	{
+		double Value;
+		if (!ParseDouble(Source, Value)) return false;
+		Callback->Get<DoubleCallbackT>()(Value);
 	}
 	return true;
 }
 
-bool ReadArrayT::StringOrBinary(std::string const &Source)
+bool ReadNestableT::DispatchSigned(int64_t Value, CallbackT *Callback)
 {
-	if (Source.substr(0, sizeof(StringPrefix) - 1) == StringPrefix)
+	if (!Callback) return true;
+	if (Callback->Is<IntCallbackT>()) Callback->Get<IntCallbackT>()(Value);
+	else if (Callback->Is<UIntCallbackT>())
 	{
-		if (Callback.Is<StringCallbackT>()) 
-			Callback.Get<StringCallbackT>()(Source.substr(sizeof(StringPrefix) - 1));
+		if (Value < 0) return false;
+		Callback->Get<UIntCallbackT>()(static_cast<uint64_t>(Value));
 	}
-	else if (Source.substr(0, sizeof(BinaryPrefix) - 1) == BinaryPrefix)
+	else if (Callback->Is<FloatCallbackT>()) Callback->Get<FloatCallbackT>()(static_cast<float>(Value));
+	else if (Callback->Is<DoubleCallbackT>()) Callback->Get<DoubleCallbackT>()(static_cast<double>(Value));
+	return true;
+}
+
+bool ReadNestableT::DispatchUnsigned(uint64_t Value, CallbackT *Callback)
+{
+	if (!Callback) return true;
+	if (Callback->Is<IntCallbackT>())
 	{
-		if (Callback.Is<BinaryCallbackT>()) 
-			Callback.Get<BinaryCallbackT>()(FromBinary(Source.substr(sizeof(BinaryPrefix) - 1)));
+		if (Value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) return false;
+		Callback->Get<IntCallbackT>()(static_cast<int64_t>(Value));
+	}
+	else if (Callback->Is<UIntCallbackT>()) Callback->Get<UIntCallbackT>()(Value);
+	else if (Callback->Is<FloatCallbackT>()) Callback->Get<FloatCallbackT>()(static_cast<float>(Value));
+	else if (Callback->Is<DoubleCallbackT>()) Callback->Get<DoubleCallbackT>()(static_cast<double>(Value));
+	return true;
+}
+
+bool ReadNestableT::DispatchReal(double Value, CallbackT *Callback)
+{
+	if (!Callback) return true;
+	// Same rules as text: integers must be whole and in range
+	if (Callback->Is<IntCallbackT>())
+	{
+		if ((Value != std::trunc(Value)) || (Value < -9223372036854775808.0) || (Value >= 9223372036854775808.0)) 
+			return false;
+		Callback->Get<IntCallbackT>()(static_cast<int64_t>(Value));
+	}
+	else if (Callback->Is<UIntCallbackT>())
+	{
+		if ((Value != std::trunc(Value)) || (Value < 0) || (Value >= 18446744073709551616.0)) return false;
+		Callback->Get<UIntCallbackT>()(static_cast<uint64_t>(Value));
+	}
+	else if (Callback->Is<FloatCallbackT>())
+	{
+		auto const Narrowed = static_cast<float>(Value);
+		if (std::isinf(Narrowed)) return false;
+		Callback->Get<FloatCallbackT>()(Narrowed);
+	}
+	else if (Callback->Is<DoubleCallbackT>()) Callback->Get<DoubleCallbackT>()(Value);
+	return true;
+}
+
+bool ReadNestableT::DispatchText(StringViewT Value, CallbackT *Callback)
+{
+	if (!Callback) return true;
+	if (Callback->Is<StringCallbackT>()) Callback->Get<StringCallbackT>()(Value.str());
+	else if (Callback->Is<StringViewCallbackT>()) Callback->Get<StringViewCallbackT>()(Value);
+	return true;
+}
+
+bool ReadNestableT::DispatchBytes(StringViewT Value, CallbackT *Callback)
+{
+	if (!Callback) return true;
+	if (Callback->Is<BinaryCallbackT>()) 
+		Callback->Get<BinaryCallbackT>()(std::vector<uint8_t>(Value.begin(), Value.end()));
+	else if (Callback->Is<BinaryIntoCallbackT>())
+	{
+		auto Out = Callback->Get<BinaryIntoCallbackT>()(Value.size());
+		if (Out) memcpy(Out, Value.data(), Value.size());
 	}
-	else return false; // Invalid string notation
 	return true;
 }
 
+bool ReadNestableT::DispatchStringOrBinary(StringViewT Source, CallbackT *Callback)
+{
+	if (Source.starts_with(StringPrefix)) return DispatchText(Source.substr(sizeof(StringPrefix) - 1), Callback);
+	else if (IsBinary(Source))
+	{
+		if (!Callback) return true;
+		size_t Length;
+		if (!BinaryLength(Source, Length)) return false;
+		if (Callback->Is<BinaryCallbackT>()) 
+		{
+			std::vector<uint8_t> Out(Length);
+			if (!DecodeBinary(Source, Out.data())) return false;
+			Callback->Get<BinaryCallbackT>()(std::move(Out));
+		}
+		else if (Callback->Is<BinaryIntoCallbackT>())
+		{
+			auto Out = Callback->Get<BinaryIntoCallbackT>()(Length);
+			if (Out && !DecodeBinary(Source, Out)) return false;
+		}
+		return true;
+	}
+	else return false; // Invalid string notation
+}
+
+//----------------------------------------------------------------------------------------------------------------
+// Nested array reader
+ReadArrayT::~ReadArrayT(void) { if (DestructorCallback) DestructorCallback(); }
+
+void ReadArrayT::Bool(LooseBoolCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<BoolCallbackT>(Callback); }
+void ReadArrayT::Int(LooseIntCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<IntCallbackT>(Callback); }
+void ReadArrayT::UInt(LooseUIntCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<UIntCallbackT>(Callback); }
+void ReadArrayT::Float(LooseFloatCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<FloatCallbackT>(Callback); }
+void ReadArrayT::Double(LooseDoubleCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<DoubleCallbackT>(Callback); }
+void ReadArrayT::String(LooseStringCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<StringCallbackT>(Callback); }
+void ReadArrayT::StringView(LooseStringViewCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<StringViewCallbackT>(Callback); }
+void ReadArrayT::Binary(LooseBinaryCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<BinaryCallbackT>(Callback); }
+void ReadArrayT::BinaryInto(LooseBinaryIntoCallbackT const &Callback) 
+	{ Assert(!this->Callback); this->Callback.Set<BinaryIntoCallbackT>(Callback); }
+void ReadArrayT::Object(LooseObjectCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<ObjectCallbackT>(Callback); }
+void ReadArrayT::Array(LooseArrayCallbackT const &Callback) { Assert(!this->Callback); this->Callback.Set<ArrayCallbackT>(Callback); }
+
+void ReadArrayT::Destructor(std::function<void(void)> const &Callback) { Assert(!DestructorCallback); DestructorCallback = Callback; }
+
+bool ReadArrayT::Bool(bool Value) 
+	{ if (Callback.Is<BoolCallbackT>()) Callback.Get<BoolCallbackT>()(Value); return true; }
+	
+bool ReadArrayT::Number(StringViewT Source) { return DispatchNumber(Source, &Callback); }
+
+bool ReadArrayT::Signed(int64_t Value) { return DispatchSigned(Value, &Callback); }
+
+bool ReadArrayT::Unsigned(uint64_t Value) { return DispatchUnsigned(Value, &Callback); }
+
+bool ReadArrayT::Real(double Value) { return DispatchReal(Value, &Callback); }
+
+bool ReadArrayT::StringOrBinary(StringViewT Source) { return DispatchStringOrBinary(Source, &Callback); }
+
+bool ReadArrayT::Text(StringViewT Value) { return DispatchText(Value, &Callback); }
+
+bool ReadArrayT::Bytes(StringViewT Value) { return DispatchBytes(Value, &Callback); }
+
 bool ReadArrayT::Object(ReadObjectT &Object)
 	{ if (Callback.Is<ObjectCallbackT>()) Callback.Get<ObjectCallbackT>()(std::ref(Object)); return true; }
 
-bool ReadArrayT::Key(std::string const &Value)
+bool ReadArrayT::Key(StringViewT Value)
 	{ return false; } // Keys shouldn't appear in arrays.  Hopefully yajl will catch this first.
 	
 bool ReadArrayT::Array(ReadArrayT &Array)
 	{ if (Callback.Is<ArrayCallbackT>()) Callback.Get<ArrayCallbackT>()(std::ref(Array)); return true; }
 
+void ReadArrayT::Close(void)
+{
+	Callback.Clear();
+	if (!DestructorCallback) return;
+	auto Destructor = std::move(DestructorCallback);
+	DestructorCallback = nullptr;
+	Destructor();
+}
+
 //----------------------------------------------------------------------------------------------------------------
 // Nested object reader
+ReadObjectT::ReadObjectT(void) : Table(nullptr), HasKey(false), LastSlot(0) {}
+
 ReadObjectT::~ReadObjectT(void) { if (DestructorCallback) DestructorCallback(); }
 
-void ReadObjectT::Bool(std::string const &Key, LooseBoolCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<BoolCallbackT>(Callback); }
-void ReadObjectT::Int(std::string const &Key, LooseIntCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<IntCallbackT>(Callback); }
-void ReadObjectT::UInt(std::string const &Key, LooseUIntCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<UIntCallbackT>(Callback); }
-void ReadObjectT::Float(std::string const &Key, LooseFloatCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<FloatCallbackT>(Callback); }
-void ReadObjectT::String(std::string const &Key, LooseStringCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<StringCallbackT>(Callback); }
-void ReadObjectT::Binary(std::string const &Key, LooseBinaryCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<BinaryCallbackT>(Callback); }
-void ReadObjectT::Object(std::string const &Key, LooseObjectCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<ObjectCallbackT>(Callback); }
-void ReadObjectT::Array(std::string const &Key, LooseArrayCallbackT const &Callback) 
-	{ Assert(!Callbacks[Key]); Callbacks[Key].Set<ArrayCallbackT>(Callback); }
+void ReadObjectT::Keys(KeyTableT const &Table)
+{
+	Assert(Callbacks.empty());
+	this->Table = &Table;
+	Slots.assign(Table.size(), 0);
+}
+
+ReadObjectT::CallbackT &ReadObjectT::Register(KeyIDT Key)
+{
+	Assert(Table);
+	AssertLT(Key, Slots.size());
+	Assert(!Slots[Key]);
+	AssertLT(Callbacks.size(), 255u);
+	Callbacks.emplace_back();
+	Slots[Key] = Callbacks.size();
+	return Callbacks.back();
+}
+
+void ReadObjectT::Bool(KeyIDT Key, LooseBoolCallbackT const &Callback) { Register(Key).Set<BoolCallbackT>(Callback); }
+void ReadObjectT::Int(KeyIDT Key, LooseIntCallbackT const &Callback) { Register(Key).Set<IntCallbackT>(Callback); }
+void ReadObjectT::UInt(KeyIDT Key, LooseUIntCallbackT const &Callback) { Register(Key).Set<UIntCallbackT>(Callback); }
+void ReadObjectT::Float(KeyIDT Key, LooseFloatCallbackT const &Callback) { Register(Key).Set<FloatCallbackT>(Callback); }
+void ReadObjectT::Double(KeyIDT Key, LooseDoubleCallbackT const &Callback) { Register(Key).Set<DoubleCallbackT>(Callback); }
+void ReadObjectT::String(KeyIDT Key, LooseStringCallbackT const &Callback) { Register(Key).Set<StringCallbackT>(Callback); }
+void ReadObjectT::StringView(KeyIDT Key, LooseStringViewCallbackT const &Callback) 
+	{ Register(Key).Set<StringViewCallbackT>(Callback); }
+void ReadObjectT::Binary(KeyIDT Key, LooseBinaryCallbackT const &Callback) { Register(Key).Set<BinaryCallbackT>(Callback); }
+void ReadObjectT::BinaryInto(KeyIDT Key, LooseBinaryIntoCallbackT const &Callback) 
+	{ Register(Key).Set<BinaryIntoCallbackT>(Callback); }
+void ReadObjectT::Object(KeyIDT Key, LooseObjectCallbackT const &Callback) { Register(Key).Set<ObjectCallbackT>(Callback); }
+void ReadObjectT::Array(KeyIDT Key, LooseArrayCallbackT const &Callback) { Register(Key).Set<ArrayCallbackT>(Callback); }
+
+void ReadObjectT::Bool(char const *Key, LooseBoolCallbackT const &Callback) { Assert(Table); Bool((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::Int(char const *Key, LooseIntCallbackT const &Callback) { Assert(Table); Int((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::UInt(char const *Key, LooseUIntCallbackT const &Callback) { Assert(Table); UInt((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::Float(char const *Key, LooseFloatCallbackT const &Callback) { Assert(Table); Float((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::Double(char const *Key, LooseDoubleCallbackT const &Callback) { Assert(Table); Double((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::String(char const *Key, LooseStringCallbackT const &Callback) { Assert(Table); String((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::StringView(char const *Key, LooseStringViewCallbackT const &Callback) 
+	{ Assert(Table); StringView((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::Binary(char const *Key, LooseBinaryCallbackT const &Callback) { Assert(Table); Binary((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::BinaryInto(char const *Key, LooseBinaryIntoCallbackT const &Callback) 
+	{ Assert(Table); BinaryInto((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::Object(char const *Key, LooseObjectCallbackT const &Callback) { Assert(Table); Object((*Table)[StringViewT(Key, strlen(Key))], Callback); }
+void ReadObjectT::Array(char const *Key, LooseArrayCallbackT const &Callback) { Assert(Table); Array((*Table)[StringViewT(Key, strlen(Key))], Callback); }
 
 void ReadObjectT::Destructor(std::function<void(void)> const &Callback) { Assert(!DestructorCallback); DestructorCallback = Callback; }
 
+ReadObjectT::CallbackT *ReadObjectT::TakeLastKey(void)
+{
+	HasKey = false;
+	if (!LastSlot) return nullptr;
+	auto Out = &Callbacks[LastSlot - 1];
+	LastSlot = 0;
+	return Out;
+}
+
 bool ReadObjectT::Bool(bool Value) 
 { 
-	if (LastKey.empty()) return false; 
-	auto Callback = Callbacks.find(LastKey);
-	if (Callback != Callbacks.end())
-		Callback->second.Get<BoolCallbackT>()(Value);
-	LastKey.clear();
+	if (!HasKey) return false; 
+	auto Callback = TakeLastKey();
+	if (Callback && Callback->Is<BoolCallbackT>())
+		Callback->Get<BoolCallbackT>()(Value);
 	return true;
 }
 	
-bool ReadObjectT::Number(std::string const &Source)
+bool ReadObjectT::Number(StringViewT Source)
 { 
-	if (LastKey.empty()) return false; 
-	auto Callback = Callbacks.find(LastKey);
-	LastKey.clear();
-	if (Callback != Callbacks.end())
-	{
-		if (Callback->second.Is<IntCallbackT>())
-		{
-			int64_t Value;
-			if (!(StringT(Source) >> Value)) return false;
-			Callback->second.Get<IntCallbackT>()(Value);
-		}
-		else if (Callback->second.Is<UIntCallbackT>())
-		{
-			uint64_t Value;
-			if (!(StringT(Source) >> Value)) return false;
-			Callback->second.Get<UIntCallbackT>()(Value);
-		}
-		else if (Callback->second.Is<FloatCallbackT>())
-		{
-			float Value;
-			if (!(StringT(Source) >> Value)) return false;
-			Callback->second.Get<FloatCallbackT>()(Value);
-		}
-	}
-	return true;
+	if (!HasKey) return false; 
+	return DispatchNumber(Source, TakeLastKey());
 }
 
-bool ReadObjectT::StringOrBinary(std::string const &Source)
+bool ReadObjectT::Signed(int64_t Value)
 { 
-	if (LastKey.empty()) return false; 
-	auto Callback = Callbacks.find(LastKey);
-	LastKey.clear();
-	if (Source.substr(0, sizeof(StringPrefix) - 1) == StringPrefix)
-	{
-		if ((Callback != Callbacks.end()) && Callback->second.Is<StringCallbackT>()) 
-			Callback->second.Get<StringCallbackT>()(Source.substr(sizeof(StringPrefix) - 1));
-	}
-	else if (Source.substr(0, sizeof(BinaryPrefix) - 1) == BinaryPrefix)
-	{
-		if ((Callback != Callbacks.end()) && Callback->second.Is<BinaryCallbackT>()) 
-			Callback->second.Get<BinaryCallbackT>()(FromBinary(Source.substr(sizeof(BinaryPrefix) - 1)));
-	}
-	else return false; // Invalid string notation
-	return true;
+	if (!HasKey) return false; 
+	return DispatchSigned(Value, TakeLastKey());
+}
+
+bool ReadObjectT::Unsigned(uint64_t Value)
+{ 
+	if (!HasKey) return false; 
+	return DispatchUnsigned(Value, TakeLastKey());
+}
+
+bool ReadObjectT::Real(double Value)
+{ 
+	if (!HasKey) return false; 
+	return DispatchReal(Value, TakeLastKey());
+}
+
+bool ReadObjectT::StringOrBinary(StringViewT Source)
+{ 
+	if (!HasKey) return false; 
+	return DispatchStringOrBinary(Source, TakeLastKey());
+}
+
+bool ReadObjectT::Text(StringViewT Value)
+{ 
+	if (!HasKey) return false; 
+	return DispatchText(Value, TakeLastKey());
+}
+
+bool ReadObjectT::Bytes(StringViewT Value)
+{ 
+	if (!HasKey) return false; 
+	return DispatchBytes(Value, TakeLastKey());
 }
 
 bool ReadObjectT::Object(ReadObjectT &Object)
 { 
-	if (LastKey.empty()) return false; 
-	auto Callback = Callbacks.find(LastKey);
-	if ((Callback != Callbacks.end()) && Callback->second.Is<ObjectCallbackT>())
-		Callback->second.Get<ObjectCallbackT>()(std::ref(Object));
-	LastKey.clear();
+	if (!HasKey) return false; 
+	auto Callback = TakeLastKey();
+	if (Callback && Callback->Is<ObjectCallbackT>())
+		Callback->Get<ObjectCallbackT>()(std::ref(Object));
 	return true;
 }
 
-bool ReadObjectT::Key(std::string const &Value) { LastKey = Value; return true; }
+bool ReadObjectT::Key(StringViewT Value) 
+{ 
+	HasKey = true;
+	LastSlot = 0;
+	if (Table)
+	{
+		auto ID = Table->Find(Value);
+		if (ID) LastSlot = Slots[*ID];
+	}
+	return true; 
+}
 
 bool ReadObjectT::Array(ReadArrayT &Array)
 { 
-	if (LastKey.empty()) return false; 
-	auto Callback = Callbacks.find(LastKey);
-	if ((Callback != Callbacks.end()) && Callback->second.Is<ArrayCallbackT>())
-		Callback->second.Get<ArrayCallbackT>()(std::ref(Array));
-	LastKey.clear();
+	if (!HasKey) return false; 
+	auto Callback = TakeLastKey();
+	if (Callback && Callback->Is<ArrayCallbackT>())
+		Callback->Get<ArrayCallbackT>()(std::ref(Array));
 	return true;
 }
 
+void ReadObjectT::Close(void)
+{
+	Table = nullptr;
+	HasKey = false;
+	LastSlot = 0;
+	Slots.clear();
+	Callbacks.clear();
+	if (!DestructorCallback) return;
+	auto Destructor = std::move(DestructorCallback);
+	DestructorCallback = nullptr;
+	Destructor();
+}
+
 //----------------------------------------------------------------------------------------------------------------
-// Nested object reader
-ReadT::ReadT(ObjectCallbackT const &Setup)
+// Reading start point
+template <typename HandlerT> int ReadT::Guard(void *UserData, HandlerT const &Handler)
+{
+	auto This = reinterpret_cast<ReadT *>(UserData);
+	if (This->Stack.empty()) return false;
+	// Unwinding through yajl isn't safe, so park the exception until yajl_parse returns
+	try { return Handler(*This); }
+	catch (...) { This->Error = std::current_exception(); return false; }
+}
+
+template <typename FrameT> FrameT &ReadT::Acquire(std::vector<std::unique_ptr<FrameT>> &Pool)
+{
+	auto Depth = Stack.size();
+	if (Pool.size() <= Depth) Pool.resize(Depth + 1);
+	if (!Pool[Depth]) Pool[Depth].reset(new FrameT);
+	return *Pool[Depth];
+}
+
+bool ReadT::PushObject(void)
+{
+	// The document's outermost object is the one prepared by Setup
+	if (!Started) { Started = true; return true; }
+	auto &NewTop = Acquire(Objects);
+	if (!Stack.back()->Object(NewTop)) return false;
+	Stack.push_back(&NewTop);
+	return true;
+}
+
+bool ReadT::PushArray(void)
+{
+	if (!Started) return false;
+	auto &NewTop = Acquire(Arrays);
+	if (!Stack.back()->Array(NewTop)) return false;
+	Stack.push_back(&NewTop);
+	return true;
+}
+
+bool ReadT::Pop(void)
+{
+	auto Top = Stack.back();
+	Stack.pop_back(); 
+	Top->Close(); 
+	return true; 
+}
+
+ReadT::ReadT(ObjectCallbackT const &Setup) : 
+	Detected(false), Format(FormatT::JSON), Started(false), Consumed(0), MagicSeen(0), Position(0)
 {
-	static auto PrepareUserData = [](void *UserData) -> OptionalT<ReadT *>
-	{
-		auto This = reinterpret_cast<ReadT *>(UserData);
-		if (This->Stack.empty()) return {};
-		return This;
-	};
-	
 	// Assuming yajl enforces json correctness, so start map start/end are matched, open/closes aren't crossed, etc
 	static yajl_callbacks Callbacks
 	{  
@@ -381,76 +1207,51 @@ ReadT::ReadT(ObjectCallbackT const &Setup)
 		nullptr,  
 		[](void *UserData, int Value) -> int // Bool
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			if (!This->Stack.top()->Bool(Value)) return false;
-			return true;
+			return Guard(UserData, [&](ReadT &This) { return This.Stack.back()->Bool(Value); });
 		},
 		nullptr,
 		nullptr,
 		[](void *UserData, char const *Value, size_t ValueLength) -> int // Number
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			if (!This->Stack.top()->Number(std::string(Value, ValueLength))) return false;
-			return true;
+			return Guard(UserData, [&](ReadT &This) 
+				{ return This.Stack.back()->Number(StringViewT(Value, ValueLength)); });
 		},
 		[](void *UserData, unsigned char const *Value, size_t ValueLength) -> int // String/Binary
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			if (!This->Stack.top()->StringOrBinary(std::string(reinterpret_cast<char const *>(Value), ValueLength))) return false;
-			return true;
+			return Guard(UserData, [&](ReadT &This) 
+				{ return This.Stack.back()->StringOrBinary(StringViewT(reinterpret_cast<char const *>(Value), ValueLength)); });
 		},
 		
 		// Object
 		[](void *UserData) -> int // Open
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			auto NewTop = new ReadObjectT;
-			if (!This->Object(*NewTop)) return false;
-			This->Stack.push(std::unique_ptr<ReadNestableT>(NewTop));
-			return true;
+			return Guard(UserData, [&](ReadT &This) { return This.PushObject(); });
 		},
 		[](void *UserData, unsigned char const *Key, size_t KeyLength) -> int // Key
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			if (!This->Stack.top()->Key(std::string(reinterpret_cast<char const *>(Key), KeyLength))) return false;
-			return true;
+			return Guard(UserData, [&](ReadT &This) 
+				{ return This.Stack.back()->Key(StringViewT(reinterpret_cast<char const *>(Key), KeyLength)); });
 		},
 		[](void *UserData) -> int // Close
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			This->Stack.pop();
-			return true;
+			return Guard(UserData, [&](ReadT &This) { return This.Pop(); });
 		},
 		
 		// Array
 		[](void *UserData) -> int // Open
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			auto NewTop = new ReadArrayT;
-			if (!This->Array(*NewTop)) return false;
-			This->Stack.push(std::unique_ptr<ReadNestableT>(NewTop));
-			return true;
+			return Guard(UserData, [&](ReadT &This) { return This.PushArray(); });
 		},
 		[](void *UserData) -> int // Close
 		{
-			auto This = PrepareUserData(UserData); 
-			if (!This) return false;
-			This->Stack.pop();
-			return true;
+			return Guard(UserData, [&](ReadT &This) { return This.Pop(); });
 		}
 	};
 	Base = yajl_alloc(&Callbacks, NULL, this);  
 	
-	auto NewTop = new ReadObjectT;
-	Setup(std::ref(*NewTop));
-	Stack.push(std::unique_ptr<ReadNestableT>(NewTop));
+	// The reader is the document's outermost object
+	Setup(std::ref(static_cast<ReadObjectT &>(*this)));
+	Stack.push_back(this);
 }
 
 ReadT::~ReadT(void)
@@ -458,4 +1259,238 @@ ReadT::~ReadT(void)
 	yajl_free(Base);
 }
 
+void ReadT::Parse(char const *Data, size_t Length)
+{
+	if (Length == 0) return;
+	if (!Detected)
+	{
+		Detected = true;
+		if (Data[0] == BinaryMagic[0]) Format = FormatT::Binary;
+	}
+	if (Format == FormatT::Binary) ParseBinary(Data, Length);
+	else
+	{
+		auto Status = yajl_parse(Base, reinterpret_cast<unsigned char const *>(Data), Length);
+		Check(Status, Data, Length);
+	}
+	Consumed += Length;
+	Position = 0;
+}
+
+void ReadT::Finish(void)
+{
+	if (Format == FormatT::Binary)
+	{
+		if ((MagicSeen < sizeof(BinaryMagic)) || !Carry.empty() || !Started || !Stack.empty()) 
+			Fail("unexpected end of input");
+		return;
+	}
+	Check(yajl_complete_parse(Base), nullptr, 0);
 }
+
+void ReadT::ParseDescriptor(int Descriptor, size_t BufferSize)
+{
+	struct stat Info;
+	if ((fstat(Descriptor, &Info) == 0) && S_ISREG(Info.st_mode) && (Info.st_size > 0))
+	{
+		size_t const Length = Info.st_size;
+		void *Mapping = mmap(nullptr, Length, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+		if (Mapping != MAP_FAILED)
+		{
+			struct UnmapT
+			{
+				void *Mapping;
+				size_t Length;
+				~UnmapT(void) { munmap(Mapping, Length); }
+			} Cleanup{Mapping, Length};
+			madvise(Mapping, Length, MADV_SEQUENTIAL);
+			Parse(reinterpret_cast<char const *>(Mapping), Length);
+			Finish();
+			return;
+		}
+		// Fall back to reading
+	}
+	
+	Assert(BufferSize > 0);
+	std::vector<char> Buffer(BufferSize);
+	while (true)
+	{
+		auto Count = read(Descriptor, Buffer.data(), Buffer.size());
+		if (Count < 0)
+		{
+			if (errno == EINTR) continue;
+			throw ConstructionErrorT() << "Error reading input: " << strerror(errno);
+		}
+		if (Count == 0) break;
+		Parse(Buffer.data(), Count);
+	}
+	Finish();
+}
+
+void ReadT::ParseFile(std::string const &Filename, size_t BufferSize)
+{
+	int Descriptor = open(Filename.c_str(), O_RDONLY);
+	if (Descriptor < 0) throw ConstructionErrorT() << "Couldn't open " << Filename << ": " << strerror(errno);
+	struct CloseT
+	{
+		int Descriptor;
+		~CloseT(void) { close(Descriptor); }
+	} Cleanup{Descriptor};
+	ParseDescriptor(Descriptor, BufferSize);
+}
+
+size_t ReadT::Offset(void) const 
+	{ return Consumed + ((Format == FormatT::Binary) ? Position : yajl_get_bytes_consumed(Base)); }
+
+void ReadT::Check(yajl_status Status, char const *Data, size_t Length)
+{
+	if (Error) 
+	{
+		auto Rethrow = Error;
+		Error = nullptr;
+		std::rethrow_exception(Rethrow);
+	}
+	if (Status == yajl_status_ok) return;
+	auto Message = yajl_get_error(Base, Data != nullptr, reinterpret_cast<unsigned char const *>(Data), Length);
+	ConstructionErrorT Out;
+	Out << "Invalid input near byte " << Offset() << ": " << reinterpret_cast<char const *>(Message);
+	yajl_free_error(Base, Message);
+	throw Out;
+}
+
+void ReadT::Fail(char const *Message) { throw ConstructionErrorT() << "Invalid input near byte " << Offset() << ": " << Message; }
+
+void ReadT::ParseBinary(char const *Data, size_t Length)
+{
+	Position = 0;
+	for (; (MagicSeen < sizeof(BinaryMagic)) && (Position < Length); ++MagicSeen, ++Position)
+		if (Data[Position] != BinaryMagic[MagicSeen]) Fail("bad binary header");
+	
+	// Finish an event left over from the last chunk
+	while (!Carry.empty() && (Position < Length))
+	{
+		auto Need = EventLength(Carry.data(), Carry.size());
+		if (Need == 0) { Carry.push_back(Data[Position++]); continue; }
+		auto Take = std::min(Need - Carry.size(), Length - Position);
+		Carry.insert(Carry.end(), Data + Position, Data + Position + Take);
+		Position += Take;
+		if (Carry.size() == Need) 
+		{
+			Event(Carry.data());
+			Carry.clear();
+		}
+	}
+	
+	// Events in this chunk are read in place
+	while (Position < Length)
+	{
+		auto Need = EventLength(Data + Position, Length - Position);
+		if ((Need == 0) || (Need > Length - Position))
+		{
+			Carry.assign(Data + Position, Data + Length);
+			Position = Length;
+			break;
+		}
+		Event(Data + Position);
+		Position += Need;
+	}
+}
+
+// Returns 0 if the event's header isn't all available yet
+size_t ReadT::EventLength(char const *Data, size_t Available)
+{
+	auto Varint = [&](size_t Start, uint64_t &Out) -> size_t // Returns the end, or 0 if incomplete
+	{
+		Out = 0;
+		for (size_t Index = 0; Index < MaxVarintLength; ++Index)
+		{
+			if (Start + Index >= Available) return 0;
+			uint8_t const Byte = Data[Start + Index];
+			Out |= static_cast<uint64_t>(Byte & 0x7f) << (Index * 7);
+			if (!(Byte & 0x80)) return Start + Index + 1;
+		}
+		Fail("overlong varint");
+		return 0;
+	};
+	uint64_t Value;
+	switch (static_cast<BinaryTagT>(Data[0]))
+	{
+		case BinaryTagT::False:
+		case BinaryTagT::True:
+		case BinaryTagT::Object:
+		case BinaryTagT::Array:
+		case BinaryTagT::Close:
+			return 1;
+		case BinaryTagT::Int:
+		case BinaryTagT::UInt:
+			return Varint(1, Value);
+		case BinaryTagT::Float:
+			return 9;
+		case BinaryTagT::String:
+		case BinaryTagT::Binary:
+		case BinaryTagT::Key:
+		{
+			auto End = Varint(1, Value);
+			if (End == 0) return 0;
+			if (Value > std::numeric_limits<size_t>::max() - End) Fail("bad length");
+			return End + Value;
+		}
+		default: Fail("unknown tag"); return 0;
+	}
+}
+
+void ReadT::Event(char const *Data)
+{
+	if (Stack.empty()) Fail("data after document");
+	if (!Started && (static_cast<BinaryTagT>(Data[0]) != BinaryTagT::Object)) Fail("document must start with an object");
+	auto Varint = [&](size_t &Index) 
+	{
+		uint64_t Out = 0;
+		for (size_t Shift = 0; ; Shift += 7)
+		{
+			uint8_t const Byte = Data[Index++];
+			Out |= static_cast<uint64_t>(Byte & 0x7f) << Shift;
+			if (!(Byte & 0x80)) return Out;
+		}
+	};
+	auto View = [&](void)
+	{
+		size_t Index = 1;
+		auto Length = Varint(Index);
+		return StringViewT(Data + Index, Length);
+	};
+	size_t Index = 1;
+	bool Result = false;
+	switch (static_cast<BinaryTagT>(Data[0]))
+	{
+		case BinaryTagT::False: Result = Stack.back()->Bool(false); break;
+		case BinaryTagT::True: Result = Stack.back()->Bool(true); break;
+		case BinaryTagT::Int:
+		{
+			auto Zigzag = Varint(Index);
+			Result = Stack.back()->Signed(static_cast<int64_t>(Zigzag >> 1) ^ -static_cast<int64_t>(Zigzag & 1));
+			break;
+		}
+		case BinaryTagT::UInt: Result = Stack.back()->Unsigned(Varint(Index)); break;
+		case BinaryTagT::Float:
+		{
+			uint64_t Bits = 0;
+			for (size_t Byte = 0; Byte < 8; ++Byte) Bits |= static_cast<uint64_t>(static_cast<uint8_t>(Data[1 + Byte])) << (Byte * 8);
+			double Value;
+			memcpy(&Value, &Bits, sizeof(Value));
+			Result = Stack.back()->Real(Value);
+			break;
+		}
+		case BinaryTagT::String: Result = Stack.back()->Text(View()); break;
+		case BinaryTagT::Binary: Result = Stack.back()->Bytes(View()); break;
+		case BinaryTagT::Key: Result = Stack.back()->Key(View()); break;
+		case BinaryTagT::Object: Result = PushObject(); break;
+		case BinaryTagT::Array: Result = PushArray(); break;
+		case BinaryTagT::Close: Result = Pop(); break;
+		default: Assert(false); break; // Rejected by EventLength
+	}
+	if (!Result) Fail("unexpected value");
+}
+
+}
+
@@ -4,14 +4,83 @@
 #include <yajl/yajl_parse.h>
 #include <yajl/yajl_gen.h>
 
-#include <map>
-#include <stack>
+#include <vector>
+#include <array>
+#include <memory>
+#include <exception>
+#include <initializer_list>
 
 #include "type.h"
 
 namespace Serial
 {
 
+// Binary fields are written as prefixed strings.  Alpha16 doubles the size but is trivial to decode; base64 is 
+// denser for large payloads.  Readers accept either.
+enum struct BinaryFormatT
+{
+	Alpha16,
+	Base64
+};
+
+enum struct FormatT
+{
+	JSON,
+	Binary // See serial.cxx, much faster to read
+};
+
+// Receives the document as it's produced
+typedef std::function<void(char const *Data, size_t Length)> SinkT;
+
+struct OutputT;
+
+// Output backend shared by all the writers of a document
+struct GeneratorT
+{
+	OutputT *Output;
+	
+	GeneratorT(void);
+	virtual ~GeneratorT(void);
+	virtual void Start(void) = 0;
+	virtual void Bool(bool Value) = 0;
+	virtual void Int(int64_t Value) = 0;
+	virtual void UInt(uint64_t Value) = 0;
+	virtual void Real(double Value) = 0;
+	virtual void String(std::string const &Value) = 0;
+	virtual void Binary(uint8_t const *Bytes, size_t Length, BinaryFormatT Format) = 0;
+	virtual void Key(std::string const &Key) = 0;
+	virtual void ObjectOpen(void) = 0;
+	virtual void ObjectClose(void) = 0;
+	virtual void ArrayOpen(void) = 0;
+	virtual void ArrayClose(void) = 0;
+};
+
+// A buffered destination for any number of documents, written one after another.  The buffer and generator are 
+// kept between documents.  Data reaches the descriptor or sink when the buffer fills, on Flush, or on destruction.
+struct OutputT
+{
+	public:
+		// Doesn't take ownership of Descriptor
+		OutputT(int Descriptor, FormatT Format = FormatT::JSON, size_t BufferSize = 1 << 16);
+		OutputT(SinkT const &Sink, FormatT Format = FormatT::JSON, size_t BufferSize = 1 << 16);
+		~OutputT(void); // Errors are lost here, call Flush first to see them
+		
+		void Write(char const *Data, size_t Length);
+		// Throws ConstructionErrorT if writing fails
+		void Flush(void);
+		
+	friend struct WriteT;
+	private:
+		static GeneratorT *CreateGenerator(FormatT Format);
+		void Send(char const *Extra, size_t ExtraLength);
+		
+		int const Descriptor;
+		SinkT const Sink;
+		std::vector<char> Buffer;
+		size_t Used;
+		std::unique_ptr<GeneratorT> Generator;
+};
+
 struct WriteObjectT;
 
 struct WriteArrayT
@@ -24,19 +93,20 @@ struct WriteArrayT
 		void Int(int64_t const &Value);
 		void UInt(uint64_t const &Value);
 		void Float(float const &Value);
+		void Double(double const &Value);
 		void String(std::string const &Value);
-		void Binary(uint8_t const *Bytes, size_t const Length);
+		void Binary(uint8_t const *Bytes, size_t const Length, BinaryFormatT Format = BinaryFormatT::Alpha16);
 		template <typename IntT, size_t Length, typename = typename std::enable_if<std::is_integral<IntT>::value>::type> 
-			void Binary(std::string const &Key, std::array<IntT, Length> const &Value)
-			{ Binary(Key, reinterpret_cast<uint8_t const *>(&Value[0]), sizeof(IntT) * Value.size()); }
+			void Binary(std::array<IntT, Length> const &Value, BinaryFormatT Format = BinaryFormatT::Alpha16)
+			{ Binary(reinterpret_cast<uint8_t const *>(&Value[0]), sizeof(IntT) * Value.size(), Format); }
 		WriteObjectT Object(void);
 		WriteArrayT Array(void);
 		
 	friend struct WriteObjectT;
 	protected:
-		WriteArrayT(yajl_gen Base);
+		WriteArrayT(GeneratorT *Base);
 		
-		yajl_gen Base;
+		GeneratorT *Base;
 };
 
 struct WriteObjectT
@@ -49,26 +119,59 @@ struct WriteObjectT
 		void Int(std::string const &Key, int64_t const &Value);
 		void UInt(std::string const &Key, uint64_t const &Value);
 		void Float(std::string const &Key, float const &Value);
+		void Double(std::string const &Key, double const &Value);
 		void String(std::string const &Key, std::string const &Value);
-		void Binary(std::string const &Key, uint8_t const *Bytes, size_t const Length);
+		void Binary(std::string const &Key, uint8_t const *Bytes, size_t const Length, 
+			BinaryFormatT Format = BinaryFormatT::Alpha16);
 		template <typename IntT, size_t Length, typename = typename std::enable_if<std::is_integral<IntT>::value>::type> 
-			void Binary(std::string const &Key, std::array<IntT, Length> const &Value)
-			{ Binary(Key, reinterpret_cast<uint8_t const *>(&Value[0]), sizeof(IntT) * Value.size()); }
+			void Binary(std::string const &Key, std::array<IntT, Length> const &Value, 
+				BinaryFormatT Format = BinaryFormatT::Alpha16)
+			{ Binary(Key, reinterpret_cast<uint8_t const *>(&Value[0]), sizeof(IntT) * Value.size(), Format); }
 		WriteObjectT Object(std::string const &Key);
 		WriteArrayT Array(std::string const &Key);
 		
 	friend struct WriteArrayT;
 	protected:
-		WriteObjectT(yajl_gen Base);
+		WriteObjectT(GeneratorT *Base);
 		
-		yajl_gen Base;
+		GeneratorT *Base;
 };
 
+// Writes one document, finished when this is destroyed
 struct WriteT : WriteObjectT
 {
-	//WriteT(std::string const &Filename);
-	WriteT(void);
-	~WriteT(void);
+	public:
+		WriteT(OutputT &Output);
+		// A single document with its own output, flushed when this is destroyed
+		WriteT(SinkT const &Sink, FormatT Format = FormatT::JSON);
+		~WriteT(void);
+		
+	private:
+		OutputT *Output;
+		bool Owned;
+};
+
+//----------------------------------------------------------------------------------------------------------------
+// Object key tables
+typedef uint16_t KeyIDT;
+
+// The keys an object schema can contain, interned once and shared by every object read with that schema.  Keys get
+// IDs in the order they're listed.  Lookup perfect-hashes the raw key bytes, so it never allocates.
+struct KeyTableT
+{
+	public:
+		KeyTableT(std::initializer_list<char const *> Keys);
+		
+		OptionalT<KeyIDT> Find(StringViewT Key) const;
+		KeyIDT operator [](StringViewT Key) const; // Key must exist
+		size_t size(void) const;
+		
+	private:
+		uint32_t Hash(StringViewT Key) const;
+		
+		std::vector<std::string> Keys;
+		uint32_t Seed;
+		std::vector<KeyIDT> Slots; // ID + 1, or 0 if empty
 };
 
 struct ReadArrayT;
@@ -78,8 +181,12 @@ typedef std::function<void(bool Value)> LooseBoolCallbackT;
 typedef std::function<void(int64_t Value)> LooseIntCallbackT;
 typedef std::function<void(uint64_t Value)> LooseUIntCallbackT;
 typedef std::function<void(float Value)> LooseFloatCallbackT;
+typedef std::function<void(double Value)> LooseDoubleCallbackT;
 typedef std::function<void(std::string &&Value)> LooseStringCallbackT;
+typedef std::function<void(StringViewT Value)> LooseStringViewCallbackT; // Only valid for the duration of the callback
 typedef std::function<void(std::vector<uint8_t> &&Value)> LooseBinaryCallbackT;
+// Returns where to decode Length bytes, or null to skip the value
+typedef std::function<uint8_t *(size_t Length)> LooseBinaryIntoCallbackT;
 typedef std::function<void(ReadObjectT &Value)> LooseObjectCallbackT;
 typedef std::function<void(ReadArrayT &Value)> LooseArrayCallbackT;
 
@@ -87,8 +194,11 @@ typedef StrictType(LooseBoolCallbackT) BoolCallbackT;
 typedef StrictType(LooseIntCallbackT) IntCallbackT;
 typedef StrictType(LooseUIntCallbackT) UIntCallbackT;
 typedef StrictType(LooseFloatCallbackT) FloatCallbackT;
+typedef StrictType(LooseDoubleCallbackT) DoubleCallbackT;
 typedef StrictType(LooseStringCallbackT) StringCallbackT;
+typedef StrictType(LooseStringViewCallbackT) StringViewCallbackT;
 typedef StrictType(LooseBinaryCallbackT) BinaryCallbackT;
+typedef StrictType(LooseBinaryIntoCallbackT) BinaryIntoCallbackT;
 typedef StrictType(LooseObjectCallbackT) ObjectCallbackT;
 typedef StrictType(LooseArrayCallbackT) ArrayCallbackT;
 
@@ -99,13 +209,47 @@ struct ReadNestableT
 		
 	friend struct ReadT;
 	protected:
+		typedef VariantT
+		<
+			BoolCallbackT, 
+			IntCallbackT, 
+			UIntCallbackT, 
+			FloatCallbackT, 
+			DoubleCallbackT, 
+			StringCallbackT,
+			StringViewCallbackT,
+			BinaryCallbackT,
+			BinaryIntoCallbackT,
+			ObjectCallbackT,
+			ArrayCallbackT
+		> CallbackT;
+		
+		// Shared by arrays and objects; Callback may be null
+		static bool DispatchNumber(StringViewT Source, CallbackT *Callback);
+		static bool DispatchSigned(int64_t Value, CallbackT *Callback);
+		static bool DispatchUnsigned(uint64_t Value, CallbackT *Callback);
+		static bool DispatchReal(double Value, CallbackT *Callback);
+		static bool DispatchText(StringViewT Value, CallbackT *Callback);
+		static bool DispatchBytes(StringViewT Value, CallbackT *Callback);
+		static bool DispatchStringOrBinary(StringViewT Source, CallbackT *Callback);
+		
 		// Stack context sensitive callbacks
 		virtual bool Bool(bool Value) = 0;
-		virtual bool Number(std::string const &Source) = 0;
-		virtual bool StringOrBinary(std::string const &Source) = 0;
+		// Views point into the parser's buffer
+		virtual bool Number(StringViewT Source) = 0;
+		virtual bool StringOrBinary(StringViewT Source) = 0;
+		// Binary documents carry typed values
+		virtual bool Signed(int64_t Value) = 0;
+		virtual bool Unsigned(uint64_t Value) = 0;
+		virtual bool Real(double Value) = 0;
+		virtual bool Text(StringViewT Value) = 0;
+		virtual bool Bytes(StringViewT Value) = 0;
 		virtual bool Object(ReadObjectT &Object) = 0;
-		virtual bool Key(std::string const &Value) = 0;
+		virtual bool Key(StringViewT Value) = 0;
 		virtual bool Array(ReadArrayT &Array) = 0;
+		
+		// Runs the destructor callback and clears the frame for reuse, keeping its storage
+		virtual void Close(void) = 0;
 };
 
 struct ReadArrayT : ReadNestableT
@@ -117,8 +261,11 @@ struct ReadArrayT : ReadNestableT
 		void Int(LooseIntCallbackT const &Callback);
 		void UInt(LooseUIntCallbackT const &Callback);
 		void Float(LooseFloatCallbackT const &Callback);
+		void Double(LooseDoubleCallbackT const &Callback);
 		void String(LooseStringCallbackT const &Callback);
+		void StringView(LooseStringViewCallbackT const &Callback);
 		void Binary(LooseBinaryCallbackT const &Callback);
+		void BinaryInto(LooseBinaryIntoCallbackT const &Callback);
 		void Object(LooseObjectCallbackT const &Callback);
 		void Array(LooseArrayCallbackT const &Callback);
 	
@@ -126,68 +273,83 @@ struct ReadArrayT : ReadNestableT
 	
 	protected:
 		bool Bool(bool Value) override;
-		bool Number(std::string const &Source) override;
-		bool StringOrBinary(std::string const &Source) override;
+		bool Number(StringViewT Source) override;
+		bool StringOrBinary(StringViewT Source) override;
+		bool Signed(int64_t Value) override;
+		bool Unsigned(uint64_t Value) override;
+		bool Real(double Value) override;
+		bool Text(StringViewT Value) override;
+		bool Bytes(StringViewT Value) override;
 		bool Object(ReadObjectT &Object) override;
-		bool Key(std::string const &Value) override;
+		bool Key(StringViewT Value) override;
 		bool Array(ReadArrayT &Array) override;
+		void Close(void) override;
 	
 	private:
-		VariantT
-		<
-			BoolCallbackT, 
-			IntCallbackT, 
-			UIntCallbackT, 
-			FloatCallbackT, 
-			StringCallbackT,
-			BinaryCallbackT,
-			ObjectCallbackT,
-			ArrayCallbackT
-		> Callback;
+		CallbackT Callback;
 		std::function<void(void)> DestructorCallback;
 };
 
 struct ReadObjectT : ReadNestableT
 {
 	public:
+		ReadObjectT(void);
 		~ReadObjectT(void);
 		
-		void Bool(std::string const &Key, LooseBoolCallbackT const &Callback);
-		void Int(std::string const &Key, LooseIntCallbackT const &Callback);
-		void UInt(std::string const &Key, LooseUIntCallbackT const &Callback);
-		void Float(std::string const &Key, LooseFloatCallbackT const &Callback);
-		void String(std::string const &Key, LooseStringCallbackT const &Callback);
-		void Binary(std::string const &Key, LooseBinaryCallbackT const &Callback);
-		void Object(std::string const &Key, LooseObjectCallbackT const &Callback);
-		void Array(std::string const &Key, LooseArrayCallbackT const &Callback);
+		// Must be called before registering callbacks; keys not in the table are skipped.  Objects with no table 
+		// skip all keys.
+		void Keys(KeyTableT const &Table);
+		
+		void Bool(KeyIDT Key, LooseBoolCallbackT const &Callback);
+		void Int(KeyIDT Key, LooseIntCallbackT const &Callback);
+		void UInt(KeyIDT Key, LooseUIntCallbackT const &Callback);
+		void Float(KeyIDT Key, LooseFloatCallbackT const &Callback);
+		void Double(KeyIDT Key, LooseDoubleCallbackT const &Callback);
+		void String(KeyIDT Key, LooseStringCallbackT const &Callback);
+		void StringView(KeyIDT Key, LooseStringViewCallbackT const &Callback);
+		void Binary(KeyIDT Key, LooseBinaryCallbackT const &Callback);
+		void BinaryInto(KeyIDT Key, LooseBinaryIntoCallbackT const &Callback);
+		void Object(KeyIDT Key, LooseObjectCallbackT const &Callback);
+		void Array(KeyIDT Key, LooseArrayCallbackT const &Callback);
+		
+		// Convenience, looks the key up in the table
+		void Bool(char const *Key, LooseBoolCallbackT const &Callback);
+		void Int(char const *Key, LooseIntCallbackT const &Callback);
+		void UInt(char const *Key, LooseUIntCallbackT const &Callback);
+		void Float(char const *Key, LooseFloatCallbackT const &Callback);
+		void Double(char const *Key, LooseDoubleCallbackT const &Callback);
+		void String(char const *Key, LooseStringCallbackT const &Callback);
+		void StringView(char const *Key, LooseStringViewCallbackT const &Callback);
+		void Binary(char const *Key, LooseBinaryCallbackT const &Callback);
+		void BinaryInto(char const *Key, LooseBinaryIntoCallbackT const &Callback);
+		void Object(char const *Key, LooseObjectCallbackT const &Callback);
+		void Array(char const *Key, LooseArrayCallbackT const &Callback);
 		
 		void Destructor(std::function<void(void)> const &Callback);
 		
 	protected:
 		bool Bool(bool Value) override;
-		bool Number(std::string const &Source) override;
-		bool StringOrBinary(std::string const &Source) override;
+		bool Number(StringViewT Source) override;
+		bool StringOrBinary(StringViewT Source) override;
+		bool Signed(int64_t Value) override;
+		bool Unsigned(uint64_t Value) override;
+		bool Real(double Value) override;
+		bool Text(StringViewT Value) override;
+		bool Bytes(StringViewT Value) override;
 		bool Object(ReadObjectT &Object) override;
-		bool Key(std::string const &Value) override;
+		bool Key(StringViewT Value) override;
 		bool Array(ReadArrayT &Array) override;
+		void Close(void) override;
 		
 	private:
-		std::string LastKey;
-		std::map
-		<
-			std::string, 
-			VariantT
-			<
-				BoolCallbackT, 
-				IntCallbackT, 
-				UIntCallbackT, 
-				FloatCallbackT, 
-				StringCallbackT,
-				BinaryCallbackT,
-				ObjectCallbackT,
-				ArrayCallbackT
-			>
-		> Callbacks;
+		CallbackT &Register(KeyIDT Key);
+		CallbackT *TakeLastKey(void);
+		
+		KeyTableT const *Table;
+		bool HasKey;
+		uint8_t LastSlot;
+		std::vector<uint8_t> Slots; // Indexed by key ID, position in Callbacks + 1 or 0 if unregistered
+		std::vector<CallbackT> Callbacks;
 		std::function<void(void)> DestructorCallback;
 };
 
@@ -196,9 +358,48 @@ struct ReadT : ReadObjectT
 	public:
 		ReadT(ObjectCallbackT const &Setup);
 		~ReadT(void);
+		
+		// Feed another chunk of the document; callbacks run synchronously.  JSON or binary documents are detected 
+		// from the first byte.  Throws ConstructionErrorT on bad input or rethrows anything thrown from a callback.
+		void Parse(char const *Data, size_t Length);
+		void Finish(void);
+		
+		// Parse a whole file or stream, then Finish.  Regular files are mapped and parsed in place; pipes and other 
+		// streams are read BufferSize bytes at a time.
+		static size_t const DefaultBufferSize = 1 << 16;
+		void ParseDescriptor(int Descriptor, size_t BufferSize = DefaultBufferSize);
+		void ParseFile(std::string const &Filename, size_t BufferSize = DefaultBufferSize);
+		
+		// Bytes consumed so far, valid from inside callbacks
+		size_t Offset(void) const;
 	private:
+		template <typename HandlerT> static int Guard(void *UserData, HandlerT const &Handler);
+		template <typename FrameT> FrameT &Acquire(std::vector<std::unique_ptr<FrameT>> &Pool);
+		bool PushObject(void);
+		bool PushArray(void);
+		bool Pop(void);
+		void Check(yajl_status Status, char const *Data, size_t Length);
+		
+		void ParseBinary(char const *Data, size_t Length);
+		size_t EventLength(char const *Data, size_t Available);
+		void Event(char const *Data);
+		void Fail(char const *Message);
+		
 		yajl_handle Base;
-		std::stack<std::unique_ptr<ReadNestableT>> Stack;
+		bool Detected;
+		FormatT Format;
+		bool Started;
+		size_t Consumed;
+		std::exception_ptr Error;
+		// Nested frames are recycled by depth, so a document only allocates frames for its deepest nesting
+		std::vector<std::unique_ptr<ReadObjectT>> Objects;
+		std::vector<std::unique_ptr<ReadArrayT>> Arrays;
+		std::vector<ReadNestableT *> Stack;
+		
+		// Binary documents
+		size_t MagicSeen;
+		size_t Position; // In the current chunk
+		std::vector<char> Carry; // An event split between chunks
 };
 
 }
@@ -0,0 +1,64 @@
+-- Tests are run as part of the build, benchmarks are only built
+local Test = function(Arguments)
+	Define.Executable(Arguments)
+	tup.definerule
+	{
+		inputs = {Arguments.Name},
+		outputs = {Arguments.Name .. '.passed'},
+		command = './' .. Arguments.Name .. ' && touch ' .. Arguments.Name .. '.passed'
+	}
+end
+
+Test
+{
+	Name = 'serialtest',
+	Sources = Item 'serialtest.cxx' + '../serial.cxx',
+	LinkFlags = ' -lyajl'
+}
+
+Define.Executable
+{
+	Name = 'serialbench',
+	Sources = Item 'serialbench.cxx' + '../serial.cxx',
+	LinkFlags = ' -lyajl'
+}
+
+Test
+{
+	Name = 'coretest',
+	Sources = Item 'coretest.cxx' + '../core.cxx',
+	BuildFlags = ' -I/usr/include/llvm-3.4 -I/usr/include/llvm-c-3.4',
+	LinkFlags = ' -lLLVM-3.4'
+}
+
+Define.Executable
+{
+	Name = 'atombench',
+	Sources = Item 'atombench.cxx' + '../core.cxx',
+	BuildFlags = ' -I/usr/include/llvm-3.4 -I/usr/include/llvm-c-3.4',
+	LinkFlags = ' -lLLVM-3.4'
+}
+
+Test
+{
+	Name = 'loadertest',
+	Sources = Item 'loadertest.cxx' + '../loader.cxx' + '../serial.cxx' + '../core.cxx',
+	BuildFlags = ' -I/usr/include/llvm-3.4 -I/usr/include/llvm-c-3.4',
+	LinkFlags = ' -lLLVM-3.4 -lyajl'
+}
+
+Test
+{
+	Name = 'deeptest',
+	Sources = Item 'deeptest.cxx' + '../core.cxx',
+	BuildFlags = ' -I/usr/include/llvm-3.4 -I/usr/include/llvm-c-3.4',
+	LinkFlags = ' -lLLVM-3.4 -lpthread'
+}
+
+Test
+{
+	Name = 'incrementaltest',
+	Sources = Item 'incrementaltest.cxx' + '../incremental.cxx' + '../core.cxx',
+	BuildFlags = ' -I/usr/include/llvm-3.4 -I/usr/include/llvm-c-3.4',
+	LinkFlags = ' -lLLVM-3.4'
+}
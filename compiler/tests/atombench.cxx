@@ -0,0 +1,52 @@
+#include "../core.h"
+#include "test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using namespace Core;
+
+// Reports the cost per referrer of attaching atoms to one shared nucleus, detaching them in random order, and
+// replacing the nucleus then resolving every referrer, like a type shared by every value in a large module.  Takes
+// the referrer count in thousands, default 1000.
+
+struct SharedT : NucleusT
+{
+	SharedT(void) : NucleusT(HARDPOSITION, KindT::Undefined) {}
+	void ReplaceWith(NucleusT *Replacement) { Replace(Replacement); }
+};
+
+template <typename BodyT> static void Measure(char const *Name, size_t Count, BodyT const &Body)
+{
+	auto const Start = std::chrono::steady_clock::now();
+	Body();
+	std::chrono::duration<double> const Elapsed = std::chrono::steady_clock::now() - Start;
+	std::cout << Name << ": " << (Elapsed.count() * 1e9 / Count) << " ns per referrer" << std::endl;
+}
+
+int main(int ArgumentCount, char **Arguments)
+{
+	size_t const Count = (ArgumentCount > 1 ? std::stoul(Arguments[1]) : 1000) * 1000;
+	std::vector<AtomT> Referrers(Count);
+	std::vector<size_t> Order(Count);
+	for (size_t Index = 0; Index < Count; ++Index) Order[Index] = Index;
+	std::shuffle(Order.begin(), Order.end(), std::mt19937(1));
+
+	AtomT Shared(new SharedT);
+	Measure("attach", Count, [&](void) { for (auto &Referrer : Referrers) Referrer = Shared; });
+	Measure("detach", Count, [&](void) { for (auto Index : Order) Referrers[Index].Clear(); });
+
+	for (auto &Referrer : Referrers) Referrer = Shared;
+	auto Original = static_cast<SharedT *>(static_cast<NucleusT *>(Shared));
+	Shared.Clear();
+	bool Resolved = true;
+	Measure("replace", Count, [&](void)
+	{
+		auto Replacement = new SharedT;
+		Original->ReplaceWith(Replacement);
+		for (auto Index : Order) Resolved = Resolved && (static_cast<NucleusT *>(Referrers[Index]) == Replacement);
+	});
+	Check(Resolved);
+	return 0;
+}
@@ -0,0 +1,309 @@
+#include "../core.h"
+#include "test.h"
+#include "program.h"
+
+using namespace Core;
+
+//================================================================================================================
+// Helpers
+// Records its destruction and holds one reference, enough to build chains and cycles
+struct ProbeT : NucleusT
+{
+	bool *Destroyed;
+	AtomT Held;
+
+	ProbeT(bool *Destroyed) : NucleusT(HARDPOSITION, KindT::Undefined), Destroyed(Destroyed) {}
+	~ProbeT(void) { if (Destroyed) *Destroyed = true; }
+	
+	void ReplaceWith(NucleusT *Replacement) { Replace(Replacement); }
+
+	void Trace(VisitT const &Visit) override
+	{
+		NucleusT::Trace(Visit);
+		Visit(Held);
+	}
+};
+
+//================================================================================================================
+// Memory
+// Heap nuclei referenced from an arena are let go when it's released
+static void TestArenaRelease(void)
+{
+	bool HeldDestroyed = false, SharedDestroyed = false, ArenaDestroyed = false;
+	auto Held = new ProbeT(&HeldDestroyed);
+	auto Shared = new ProbeT(&SharedDestroyed);
+	AtomT SharedOutside(Shared);
+	{
+		ArenaT Arena;
+		{
+			ArenaT::ScopeT Scope(Arena);
+			auto First = new ProbeT(&ArenaDestroyed);
+			First->Held = Held;
+			auto Second = new ProbeT(nullptr);
+			Second->Held = Shared;
+			auto Third = new ProbeT(nullptr);
+			Third->Held = Shared;
+		}
+	}
+	Check(ArenaDestroyed);
+	Check(HeldDestroyed);
+	Check(!SharedDestroyed);
+	SharedOutside.Clear();
+	Check(SharedDestroyed);
+}
+
+// Releasing drops a module without freeing it node by node, and clears the atoms left pointing into it
+static void TestModuleRelease(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	AtomT Module, Top;
+	{
+		ArenaT::ScopeT Scope(Arena);
+		Top = Run(LLVM, Module, {
+			Assign("a", Group({Assign("b", Int(4))})),
+			Assign("output", Int(0))});
+	}
+	Check(Module && Top);
+	auto const Pooled = Arena.Pooled();
+	Arena.Release();
+	Check(!Module && !Top);
+	Check(Arena.Pooled() == Pooled);
+	
+	// Letting go of the module first goes through the free lists instead
+	{
+		ArenaT::ScopeT Scope(Arena);
+		Run(LLVM, Module, {Assign("output", Int(0))});
+	}
+	Module.Clear();
+	Check(Arena.Pooled() > Pooled);
+}
+
+// Cycles only reachable from themselves are freed, anything referenced from outside the arena's nuclei is kept
+static void TestCollect(void)
+{
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+
+	bool FirstDestroyed = false, SecondDestroyed = false, RootDestroyed = false, ChildDestroyed = false;
+	{
+		auto First = new ProbeT(&FirstDestroyed);
+		AtomT Start(First);
+		auto Second = new ProbeT(&SecondDestroyed);
+		First->Held = Second;
+		Second->Held = First;
+	}
+	Check(!FirstDestroyed);
+
+	auto Root = new ProbeT(&RootDestroyed);
+	AtomT Outside(Root);
+	auto Child = new ProbeT(&ChildDestroyed);
+	Root->Held = Child;
+	Child->Held = Root;
+
+	auto Stats = Arena.Collect();
+	Check(Stats.Scanned == 4);
+	Check(Stats.Freed == 2);
+	Check(FirstDestroyed && SecondDestroyed);
+	Check(!RootDestroyed && !ChildDestroyed);
+	Check(Arena.CollectTotals().Freed == 2);
+}
+
+//================================================================================================================
+// Core
+// Referrers move to the replacement as they're accessed; the stub lives until the last one has moved
+static void TestReplace(void)
+{
+	bool FirstDestroyed = false, SecondDestroyed = false, ThirdDestroyed = false;
+	auto First = new ProbeT(&FirstDestroyed);
+	AtomT A(First), B(First);
+	auto Second = new ProbeT(&SecondDestroyed);
+	First->ReplaceWith(Second);
+	Check(!FirstDestroyed);
+	Check(static_cast<NucleusT *>(A) == Second);
+	Check(!FirstDestroyed);
+	
+	// Chains are followed, B still points at the first stub
+	auto Third = new ProbeT(&ThirdDestroyed);
+	Second->ReplaceWith(Third);
+	Check(B.Kind() == KindT::Undefined);
+	Check(static_cast<NucleusT *>(B) == Third);
+	Check(FirstDestroyed);
+	Check(!SecondDestroyed);
+	Check(static_cast<NucleusT *>(A) == Third);
+	Check(SecondDestroyed);
+	
+	// Replacing with nothing clears the referrers
+	Third->ReplaceWith(nullptr);
+	Check(ThirdDestroyed);
+	Check(!A);
+	Check(!B);
+}
+
+// Unreferenced nuclei have nothing to forward, but must not leak
+static void TestReplaceUnreferenced(void)
+{
+	bool FirstDestroyed = false, SecondDestroyed = false;
+	auto First = new ProbeT(&FirstDestroyed);
+	First->ReplaceWith(new ProbeT(&SecondDestroyed));
+	Check(SecondDestroyed);
+	Check(!FirstDestroyed);
+	First->ReplaceWith(nullptr);
+	Check(FirstDestroyed);
+	
+	// A referenced replacement is left alone
+	bool ThirdDestroyed = false, FourthDestroyed = false;
+	auto Fourth = new ProbeT(&FourthDestroyed);
+	AtomT Held(Fourth);
+	auto Third = new ProbeT(&ThirdDestroyed);
+	Third->ReplaceWith(Fourth);
+	Check(!FourthDestroyed);
+	delete Third;
+}
+
+//================================================================================================================
+// Types
+// Equal types intern to one node, and simplifying a clone never turns the template's type nodes into stubs
+static void TestInterner(void)
+{
+	llvm::LLVMContext LLVM;
+	TypeInternerT Types;
+	auto Context = ContextT(LLVM, nullptr, nullptr, nullptr, HARDPOSITION, true).WithTypes(&Types);
+	
+	auto Canonical = Types.Numeric(HARDPOSITION, 5, false, true, NumericTypeT::DataTypeT::Float);
+	Check(Types.Numeric(HARDPOSITION, 5, false, true, NumericTypeT::DataTypeT::Float) == Canonical);
+	Check(Types.Numeric(HARDPOSITION, 5, true, true, NumericTypeT::DataTypeT::Float) != Canonical);
+	
+	auto Local = new NumericTypeT(HARDPOSITION);
+	Local->ID = 5;
+	Local->Constant = false;
+	Local->DataType = NumericTypeT::DataTypeT::Float;
+	auto Template = new GroupT(HARDPOSITION);
+	AtomT TemplateAtom(Template);
+	Template->Statements.push_back(Local);
+	Template->Statements.push_back(Canonical);
+	
+	for (int Pass = 0; Pass < 2; ++Pass)
+	{
+		auto Clone = Template->Clone();
+		auto CloneGroup = *Clone.As<GroupT>();
+		Check(static_cast<NucleusT *>(CloneGroup->Statements[0]) != Local);
+		Check(static_cast<NucleusT *>(CloneGroup->Statements[1]) == Canonical);
+		SimplifyEngineT::Run(Context, Clone);
+		Check(static_cast<NucleusT *>(CloneGroup->Statements[0]) == Canonical);
+		Check(Template->Statements[0].Kind() == KindT::NumericType);
+		Check(static_cast<NucleusT *>(Template->Statements[0]) == Local);
+		Check(!Local->Interned);
+	}
+}
+
+// Calls reusing a compiled specialization get the constant parts of its output too
+static void TestConstantOutputs(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	AtomT Module;
+	auto Top = Run(LLVM, Module, {
+		Assign("f", Function(1, 
+			Group({Assign("q", IntType(false))}), 
+			Group({Assign("m", IntType(true)), Assign("r", IntType(false))}), 
+			Block({
+				Assign(Element("m", Element("output")), Element("q", Element("input"))),
+				Assign(Element("r", Element("output")), Element("q", Element("input")))}))),
+		Assign("a", Call(Element("f"), Group({Assign("q", Int(3))}))),
+		Assign("b", Call(Element("f"), Group({Assign("q", Int(3))}))),
+		Assign("output", Int(0))});
+	Check(HasInt(Top, {"a", "r"}, 3));
+	Check(HasInt(Top, {"b", "r"}, 3));
+}
+
+// Constant operands fold with the generated instructions' wrapping and signedness, and calls whose inputs and 
+// outputs are all constant are evaluated instead of compiled
+static void TestFolding(void)
+{
+	typedef BinaryOperationT::OperatorT OperatorT;
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	AtomT Module;
+	auto Top = Run(LLVM, Module, {
+		Assign("a", Binary(OperatorT::Add, Int(2147483647), Int(1))),
+		Assign("b", Binary(OperatorT::Divide, Int(-7), Int(2))),
+		Assign("c", Binary(OperatorT::Remainder, Int(-7), Int(2))),
+		Assign("d", Binary(OperatorT::ShiftLeft, Int(1), Int(31))),
+		Assign("e", Binary(OperatorT::ShiftRight, Int(-8), Int(1))),
+		Assign("f", Binary(OperatorT::Less, Int(3), Int(4))),
+		Assign("g", Binary(OperatorT::Equal, Int(3), Int(4))),
+		Assign("h", Binary(OperatorT::Xor, Binary(OperatorT::Multiply, Int(6), Int(7)), Int(2))),
+		Assign("square", Function(1, 
+			Group({Assign("q", IntType(false))}), 
+			Group({Assign("r", IntType(false))}), 
+			Block({
+				Assign(Element("r", Element("output")), Binary(OperatorT::Add, 
+					Binary(OperatorT::Multiply, Element("q", Element("input")), Element("q", Element("input"))), 
+					Int(1)))}))),
+		Assign("i", Call(Element("square"), Group({Assign("q", Int(5))}))),
+		Assign("j", Call(Element("square"), Group({Assign("q", Int(5))}))),
+		Assign("output", Int(0))});
+	Check(HasInt(Top, {"a"}, -2147483647 - 1));
+	Check(HasInt(Top, {"b"}, -3));
+	Check(HasInt(Top, {"c"}, -1));
+	Check(HasInt(Top, {"d"}, -2147483647 - 1));
+	Check(HasInt(Top, {"e"}, -4));
+	Check(HasInt(Top, {"f"}, 1));
+	Check(HasInt(Top, {"g"}, 0));
+	Check(HasInt(Top, {"h"}, 40));
+	Check(HasInt(Top, {"i", "r"}, 26));
+	Check(HasInt(Top, {"j", "r"}, 26));
+	
+	// The second identical call is memoized rather than evaluated again
+	Check((*Module.As<ModuleT>())->Budget.Evaluated == 1);
+}
+
+// A function evaluated at compile time, called with a constant
+static void Evaluate(llvm::LLVMContext &LLVM, AtomT &Module, size_t MaxSteps, size_t MaxBytes)
+{
+	typedef BinaryOperationT::OperatorT OperatorT;
+	auto Prepared = Prepare(Module, {
+		Assign("square", Function(1, 
+			Group({Assign("q", IntType(false))}), 
+			Group({Assign("r", IntType(false))}), 
+			Block({
+				Assign(Element("r", Element("output")), 
+					Binary(OperatorT::Multiply, Element("q", Element("input")), Element("q", Element("input"))))}))),
+		Assign("a", Call(Element("square"), Group({Assign("q", Int(5))}))),
+		Assign("output", Int(0))});
+	Prepared->Budget.MaxSteps = MaxSteps;
+	Prepared->Budget.MaxBytes = MaxBytes;
+	Run(LLVM, Module);
+}
+
+// Evaluations that run past the module's step or byte budget are errors
+static void TestBudget(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	{
+		AtomT Module;
+		Evaluate(LLVM, Module, 1 << 24, 1 << 28);
+		Check(HasInt(*(*Module.As<ModuleT>())->Top.As<GroupT>(), {"a", "r"}, 25));
+	}
+	CheckDies("Error at", { AtomT Module; Evaluate(LLVM, Module, 3, 1 << 28); });
+	CheckDies("Error at", { AtomT Module; Evaluate(LLVM, Module, 1 << 24, 0); });
+}
+
+int main(void)
+{
+	TestArenaRelease();
+	TestModuleRelease();
+	TestCollect();
+	TestReplace();
+	TestReplaceUnreferenced();
+	TestInterner();
+	TestConstantOutputs();
+	TestFolding();
+	TestBudget();
+	return 0;
+}
@@ -0,0 +1,134 @@
+#include "../core.h"
+#include "test.h"
+#include "program.h"
+
+#include <pthread.h>
+
+using namespace Core;
+
+// Trees nested far deeper than any native recursion over them could go.  Runs on a thread with a small stack, so 
+// anything that still recurses per level crashes instead of passing by luck.
+
+static size_t const Depth = 100000;
+
+// Function bodies are cloned for each call, including the functions defined inside them, so the work for nested 
+// calls grows with the square of their depth
+static size_t const CallDepth = 300;
+
+static size_t const StackSize = 256 << 10;
+
+// {a: {a: ... {a: Value}}}
+static AtomT NestedGroup(size_t Depth, int32_t Value)
+{
+	auto Out = Int(Value);
+	for (size_t Level = 0; Level < Depth; ++Level) Out = Group({Assign("a", Out)});
+	return Out;
+}
+
+static bool HasNestedInt(GroupT *Top, char const *Name, size_t Depth, int32_t Expected)
+{
+	auto At = Top->GetByKey(SymbolT(Name));
+	for (size_t Level = 0; At && (Level < Depth); ++Level)
+	{
+		auto Group = At->As<GroupT>();
+		if (!Group) return false;
+		At = Group->GetByKey(SymbolT("a"));
+	}
+	if (!At) return false;
+	auto Number = At->As<NumericT<int32_t>>();
+	return Number && Number->Initialized && (Number->Data == Expected);
+}
+
+// Nested literals are simplified, then assigned into an existing tree of the same shape member by member
+static void TestGroups(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	AtomT Module;
+	auto Top = Run(LLVM, Module, {
+		Assign("x", NestedGroup(Depth, 1)),
+		Assign("y", NestedGroup(Depth, 2)),
+		Assign("y", Element("x")),
+		Assign("output", Int(0))});
+	Check(HasNestedInt(Top, "x", Depth, 1));
+	Check(HasNestedInt(Top, "y", Depth, 1));
+}
+
+// 1 + (1 + (... + 1))
+static void TestOperations(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	auto Sum = Int(1);
+	for (size_t Level = 0; Level < Depth; ++Level) Sum = Binary(BinaryOperationT::OperatorT::Add, Int(1), Sum);
+	AtomT Module;
+	auto Top = Run(LLVM, Module, {Assign("x", Sum), Assign("output", Int(0))});
+	Check(HasInt(Top, {"x"}, Depth + 1));
+}
+
+// Calling the function clones its body, nested literal and all
+static void TestClone(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	AtomT Module;
+	auto Top = Run(LLVM, Module, {
+		Assign("f", Function(1, 
+			Group({Assign("q", IntType(false))}), 
+			Group({Assign("r", IntType(false))}), 
+			Block({
+				Assign("t", NestedGroup(Depth, 1)),
+				Assign(Element("r", Element("output")), Element("q", Element("input")))}))),
+		Assign("x", Call(Element("f"), Group({Assign("q", Int(4))}))),
+		Assign("output", Int(0))});
+	Check(HasInt(Top, {"x", "r"}, 4));
+}
+
+// Each function calls the one defined in its body, the innermost returns its input
+static void TestCalls(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	auto Input = [](void) { return Group({Assign("q", IntType(false))}); };
+	auto Output = [](void) { return Group({Assign("r", IntType(false))}); };
+	auto Inner = Function(1, Input(), Output(), 
+		Block({Assign(Element("r", Element("output")), Element("q", Element("input")))}));
+	for (size_t Level = 1; Level < CallDepth; ++Level)
+	{
+		Inner = Function(1 + Level, Input(), Output(), Block({
+			Assign("g", Inner),
+			Assign("i", Group({Assign("q", Int(0))})),
+			Assign(Element("q", Element("i")), Element("q", Element("input"))),
+			Assign(Element("r", Element("output")), Element("r", Call(Element("g"), Element("i"))))}));
+	}
+	AtomT Module;
+	auto Top = Run(LLVM, Module, {
+		Assign("f", Inner),
+		Assign("x", Call(Element("f"), Group({Assign("q", Int(9))}))),
+		Assign("output", Int(0))});
+	Check(HasInt(Top, {"x", "r"}, 9));
+}
+
+static void *Test(void *)
+{
+	TestGroups();
+	TestOperations();
+	TestClone();
+	TestCalls();
+	return nullptr;
+}
+
+int main(void)
+{
+	pthread_attr_t Attributes;
+	Check(pthread_attr_init(&Attributes) == 0);
+	Check(pthread_attr_setstacksize(&Attributes, StackSize) == 0);
+	pthread_t Thread;
+	Check(pthread_create(&Thread, &Attributes, Test, nullptr) == 0);
+	Check(pthread_join(Thread, nullptr) == 0);
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include "../incremental.h"
+#include "test.h"
+#include "program.h"
+
+using namespace Core;
+
+//================================================================================================================
+// Helpers
+struct EditsT
+{
+	int32_t Offset = 0; // Added by square
+	int32_t Input = 4; // Of the call in c
+	bool Relay = false; // Doubles relay's result
+	bool WithA = true;
+};
+
+// square and its constant calls can be restored; relay is compiled, so its call in d is simplified every build
+static GroupT *Build(SessionT &Session, AtomT &Module, EditsT const &Edits, SessionT::StatsT &Stats)
+{
+	typedef BinaryOperationT::OperatorT OperatorT;
+	AtomT RelayResult = Element("q", Element("input"));
+	if (Edits.Relay) RelayResult = Binary(OperatorT::Multiply, RelayResult, Int(2));
+	std::vector<AtomT> Statements{
+		Assign("square", Function(1,
+			Group({Assign("q", IntType(false))}),
+			Group({Assign("r", IntType(false))}),
+			Block({
+				Assign(Element("r", Element("output")), Binary(OperatorT::Add,
+					Binary(OperatorT::Multiply, Element("q", Element("input")), Element("q", Element("input"))),
+					Int(Edits.Offset)))}))),
+		Assign("a", Call(Element("square"), Group({Assign("q", Int(5))}))),
+		Assign("g", Group({Assign("q", Int(Edits.Input))})),
+		Assign("c", Call(Element("square"), Element("g"))),
+		Assign("relay", Function(2,
+			Group({Assign("q", IntType(false))}),
+			Group({Assign("m", IntType(true))}),
+			Block({Assign(Element("m", Element("output")), RelayResult)}))),
+		Assign("d", Call(Element("relay"), Group({Assign("q", Int(3))}))),
+		Assign("output", Int(0))};
+	if (!Edits.WithA) Statements.erase(Statements.begin() + 1);
+	auto Prepared = Prepare(Module, {});
+	auto Top = *Prepared->Top.As<GroupT>();
+	for (auto &Statement : Statements) Top->Statements.push_back(Statement);
+	Stats = Session.Build(Module);
+	return Top;
+}
+
+// The module's only function besides main
+static llvm::Function *Compiled(SessionT &Session)
+{
+	llvm::Function *Out = nullptr;
+	for (auto &Function : *Session.Output())
+	{
+		if (Function.getName() == "main") continue;
+		Check(!Out);
+		Out = &Function;
+	}
+	return Out;
+}
+
+//================================================================================================================
+// Tests
+static void TestSession(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	SessionT Session(LLVM);
+	EditsT Edits;
+	SessionT::StatsT Stats;
+
+	AtomT First;
+	auto Top = Build(Session, First, Edits, Stats);
+	Check(Stats.Simplified == 7);
+	Check(Stats.Restored == 0);
+	Check(HasInt(Top, {"a", "r"}, 25));
+	Check(HasInt(Top, {"c", "r"}, 16));
+	auto const Relay = Compiled(Session);
+	Check(Relay);
+	auto const Output = Session.Output();
+
+	// Unchanged: only statements that emit code into main run again, and relay's specialization is reused
+	{
+		AtomT Module;
+		Top = Build(Session, Module, Edits, Stats);
+	}
+	Check(Stats.Simplified == 2);
+	Check(Stats.Restored == 5);
+	Check(Stats.Erased == 0);
+	Check(Session.Output() == Output);
+	Check(Compiled(Session) == Relay);
+
+	// Statements reading an edited key run again
+	Edits.Input = 6;
+	AtomT Module;
+	Top = Build(Session, Module, Edits, Stats);
+	Check(Stats.Simplified == 4); // g, c, d, output
+	Check(HasInt(Top, {"a", "r"}, 25));
+	Check(HasInt(Top, {"c", "r"}, 36));
+
+	Edits.Offset = 1;
+	Top = Build(Session, Module, Edits, Stats);
+	Check(Stats.Simplified == 5); // square, a, c, d, output
+	Check(HasInt(Top, {"a", "r"}, 26));
+	Check(HasInt(Top, {"c", "r"}, 37));
+
+	// The old specialization is erased once nothing can call it
+	Edits.Relay = true;
+	Top = Build(Session, Module, Edits, Stats);
+	Check(Stats.Simplified == 3); // relay, d, output
+	Check(Stats.Erased == 1);
+	Check(Compiled(Session));
+
+	// Removing a statement only affects statements that touched what it wrote
+	Edits.WithA = false;
+	Top = Build(Session, Module, Edits, Stats);
+	Check(Stats.Simplified == 2);
+	Check(Stats.Restored == 4);
+	Check(!Top->GetByKey(SymbolT("a")));
+	Check(HasInt(Top, {"c", "r"}, 37));
+}
+
+// Statements that alias or change values other statements made aren't restored, since those values may be shared
+static void TestModified(void)
+{
+	llvm::LLVMContext LLVM;
+	ArenaT Arena;
+	ArenaT::ScopeT Scope(Arena);
+	SessionT Session(LLVM);
+	SessionT::StatsT Stats;
+	for (int Build = 0; Build < 2; ++Build)
+	{
+		AtomT Module;
+		auto Top = *Prepare(Module, {
+			Assign("a", Int(1)),
+			Assign("b", Element("a")),
+			Assign("a", Int(2)),
+			Assign("output", Int(0))})->Top.As<GroupT>();
+		Stats = Session.Build(Module);
+		Check(HasInt(Top, {"a"}, 2));
+		Check(HasInt(Top, {"b"}, 2));
+	}
+	Check(Stats.Restored == 1); // Only the first assignment to a
+	Check(Stats.Simplified == 3);
+}
+
+int main(void)
+{
+	TestSession();
+	TestModified();
+	return 0;
+}
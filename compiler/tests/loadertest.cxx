@@ -0,0 +1,61 @@
+#include "../loader.h"
+#include "test.h"
+
+using namespace Core;
+
+//================================================================================================================
+// Helpers
+static AtomT LoadText(std::string const &Text)
+{
+	std::istringstream Input(Text);
+	return Load(Input, "test");
+}
+
+// A module whose top group holds Statement
+static std::string Module(std::string const &Statement)
+	{ return "{\"name\": \"utf8:test\", \"top\": {\"group\": {\"statements\": [" + Statement + "]}}}"; }
+
+//================================================================================================================
+// Tests
+static void TestWellFormed(void)
+{
+	auto Out = LoadText(Module(
+		"{\"assignment\": {\"left\": {\"element\": {\"name\": \"utf8:a\"}}, \"right\": {\"int\": {\"value\": 4}}}}"));
+	auto Loaded = Out.As<ModuleT>();
+	Check(Loaded);
+	auto Top = (*Loaded)->Top.As<GroupT>();
+	Check(Top);
+	Check((*Top)->Statements.size() == 1);
+	auto Assignment = (*Top)->Statements[0].As<AssignmentT>();
+	Check(Assignment);
+	Check((*Assignment)->Left.Kind() == KindT::Element);
+	Check((*Assignment)->Right.Kind() == KindT::Int);
+}
+
+// Every node object names exactly one kind
+static void TestKinds(void)
+{
+	CheckThrows(ConstructionErrorT, LoadText("{\"name\": \"utf8:test\", \"top\": {}}"));
+	CheckThrows(ConstructionErrorT, LoadText(Module("{}")));
+	CheckThrows(ConstructionErrorT, LoadText(Module("{\"unknown\": {\"value\": 4}}")));
+	CheckThrows(ConstructionErrorT, LoadText(Module(
+		"{\"assignment\": {\"left\": {}, \"right\": {\"int\": {\"value\": 4}}}}")));
+	CheckThrows(ConstructionErrorT, LoadText(Module(
+		"{\"int\": {\"value\": 4}, \"string\": {\"value\": \"utf8:a\"}}")));
+	CheckThrows(ConstructionErrorT, LoadText(Module("{\"int\": {\"value\": 4}, \"int\": {\"value\": 5}}")));
+}
+
+int main(void)
+{
+	try
+	{
+		TestWellFormed();
+		TestKinds();
+	}
+	catch (ConstructionErrorT const &Error)
+	{
+		std::cerr << "Unexpected error: " << Error << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,127 @@
+#ifndef program_h
+#define program_h
+
+#include "../core.h"
+
+// Builders for small programs, for tests that need more than single nodes
+namespace Core
+{
+
+inline AtomT Int(int32_t Value)
+{
+	auto Type = new NumericTypeT(HARDPOSITION);
+	Type->Static = false;
+	auto Out = new NumericT<int32_t>(HARDPOSITION);
+	Out->Type = Type;
+	Out->Initialized = true;
+	Out->Data = Value;
+	return Out;
+}
+
+inline AtomT IntType(bool Dynamic)
+{
+	auto Type = new NumericTypeT(HARDPOSITION);
+	if (!Dynamic) return Type;
+	auto Out = new AsDynamicTypeT(HARDPOSITION);
+	Out->Type = Type;
+	return Out;
+}
+
+inline AtomT Element(std::string const &Name, AtomT Base = {})
+{
+	auto Out = new ElementT(HARDPOSITION);
+	Out->Name = SymbolT(Name);
+	Out->Base = Base;
+	return Out;
+}
+
+inline AtomT Assign(AtomT Left, AtomT Right)
+{
+	auto Out = new AssignmentT(HARDPOSITION);
+	Out->Left = Left;
+	Out->Right = Right;
+	return Out;
+}
+
+inline AtomT Assign(std::string const &Name, AtomT Right) { return Assign(Element(Name), Right); }
+
+template <typename ContainerT> inline AtomT Statements(ContainerT *Out, std::initializer_list<AtomT> Statements)
+{
+	for (auto &Statement : Statements) Out->Statements.push_back(Statement);
+	return Out;
+}
+
+inline AtomT Group(std::initializer_list<AtomT> List) { return Statements(new GroupT(HARDPOSITION), List); }
+
+inline AtomT Block(std::initializer_list<AtomT> List) { return Statements(new BlockT(HARDPOSITION), List); }
+
+inline AtomT Function(uint16_t ID, AtomT Input, AtomT Output, AtomT Body)
+{
+	auto Type = new FunctionTypeT(HARDPOSITION);
+	Type->ID = ID;
+	Type->Signature = Group({Assign("input", Input), Assign("output", Output)});
+	auto Out = new ImplementT(HARDPOSITION);
+	Out->Type = Type;
+	Out->Value = Body;
+	return Out;
+}
+
+inline AtomT Call(AtomT Function, AtomT Input)
+{
+	auto Out = new CallT(HARDPOSITION);
+	Out->Function = Function;
+	Out->Input = Input;
+	return Out;
+}
+
+inline AtomT Binary(BinaryOperationT::OperatorT Operator, AtomT Left, AtomT Right)
+{
+	auto Out = new BinaryOperationT(HARDPOSITION);
+	Out->Operator = Operator;
+	Out->Left = Left;
+	Out->Right = Right;
+	return Out;
+}
+
+// An entry module with the statements at the top, ready to run
+inline ModuleT *Prepare(AtomT &Module, std::initializer_list<AtomT> List)
+{
+	auto Out = new ModuleT(HARDPOSITION);
+	Module = Out;
+	Out->Name = "test";
+	Out->Entry = true;
+	Out->Top = Group(List);
+	return Out;
+}
+
+// Simplifies a prepared module, returning the top group
+inline GroupT *Run(llvm::LLVMContext &LLVM, AtomT &Module)
+{
+	SimplifyEngineT::Run(ContextT(LLVM, nullptr, nullptr, nullptr, HARDPOSITION, true), Module);
+	return *(*Module.As<ModuleT>())->Top.As<GroupT>();
+}
+
+inline GroupT *Run(llvm::LLVMContext &LLVM, AtomT &Module, std::initializer_list<AtomT> List)
+{
+	Prepare(Module, List);
+	return Run(LLVM, Module);
+}
+
+inline bool HasInt(GroupT *Top, std::initializer_list<char const *> Path, int32_t Expected)
+{
+	AtomT At = Top;
+	for (auto Key : Path)
+	{
+		auto Group = At.As<GroupT>();
+		if (!Group) return false;
+		auto Found = Group->GetByKey(SymbolT(Key));
+		if (!Found) return false;
+		At = *Found;
+	}
+	auto Number = At.As<NumericT<int32_t>>();
+	return Number && Number->Initialized && (Number->Data == Expected);
+}
+
+}
+
+#endif
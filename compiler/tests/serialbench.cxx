@@ -0,0 +1,145 @@
+#include "../serial.h"
+#include "test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+
+using namespace Serial;
+
+// Reports reader throughput in MB/s and heap allocations per node read for syntax-tree-shaped documents, from memory 
+// and from a mapped file, in both formats.  Takes the document size in MB, default 64.
+
+// Every allocation in the process is counted
+static size_t Allocations = 0;
+
+void *operator new(size_t Size)
+{
+	++Allocations;
+	if (auto Out = std::malloc(Size ? Size : 1)) return Out;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *Pointer) noexcept { std::free(Pointer); }
+
+static KeyTableT const Keys{"name", "statements", "assignment", "left", "right", "int", "value"};
+
+// Statements like {"assignment": {"left": {"name": "..."}, "right": {"int": {"value": N}}}}
+static std::string Write(FormatT Format, size_t Size)
+{
+	std::string Out;
+	Out.reserve(Size + (1 << 16));
+	WriteT Writer([&](char const *Data, size_t Length) { Out.append(Data, Length); }, Format);
+	auto Statements = Writer.Array("statements");
+	for (int64_t Index = 0; Out.size() < Size; ++Index)
+	{
+		auto Statement = Statements.Object();
+		auto Assignment = Statement.Object("assignment");
+		Assignment.Object("left").String("name", "element" + std::to_string(Index % 1000));
+		Assignment.Object("right").Object("int").Int("value", Index);
+	}
+	return Out;
+}
+
+struct TotalsT
+{
+	size_t Statements = 0;
+	size_t Nodes = 0; // Objects and values
+	int64_t Sum = 0;
+};
+
+static void Setup(ReadObjectT &Object, TotalsT &Totals)
+{
+	Object.Keys(Keys);
+	Object.Array("statements", [&](ReadArrayT &Statements)
+	{
+		Statements.Object([&](ReadObjectT &Statement)
+		{
+			++Totals.Statements;
+			++Totals.Nodes;
+			Statement.Keys(Keys);
+			Statement.Object("assignment", [&](ReadObjectT &Assignment)
+			{
+				++Totals.Nodes;
+				Assignment.Keys(Keys);
+				Assignment.Object("left", [&](ReadObjectT &Left)
+				{
+					++Totals.Nodes;
+					Left.Keys(Keys);
+					Left.StringView("name", [&](StringViewT Value) { ++Totals.Nodes; Totals.Sum += Value.size(); });
+				});
+				Assignment.Object("right", [&](ReadObjectT &Right)
+				{
+					++Totals.Nodes;
+					Right.Keys(Keys);
+					Right.Object("int", [&](ReadObjectT &Int)
+					{
+						++Totals.Nodes;
+						Int.Keys(Keys);
+						Int.Int("value", [&](int64_t Value) { ++Totals.Nodes; Totals.Sum += Value; });
+					});
+				});
+			});
+		});
+	});
+}
+
+template <typename FeedT> static void Measure(char const *Name, size_t Size, TotalsT const &Expected, FeedT const &Feed)
+{
+	TotalsT Totals;
+	auto const StartAllocations = Allocations;
+	auto const Start = std::chrono::steady_clock::now();
+	{
+		ReadT Reader([&](ReadObjectT &Object) { Setup(Object, Totals); });
+		Feed(Reader);
+	}
+	std::chrono::duration<double> const Elapsed = std::chrono::steady_clock::now() - Start;
+	auto const Allocated = Allocations - StartAllocations;
+	Check(Totals.Statements == Expected.Statements);
+	Check(Totals.Sum == Expected.Sum);
+	std::cout << Name << ": " << (Size / Elapsed.count() / (1 << 20)) << " MB/s, " << 
+		(double(Allocated) / Totals.Nodes) << " allocations per node" << std::endl;
+}
+
+int main(int ArgumentCount, char **Arguments)
+{
+	size_t const Size = (ArgumentCount > 1 ? std::stoul(Arguments[1]) : 64) << 20;
+	try
+	{
+		for (auto Format : {FormatT::JSON, FormatT::Binary})
+		{
+			auto const FormatName = Format == FormatT::JSON ? "json" : "binary";
+			auto const Document = Write(Format, Size);
+
+			TotalsT Expected;
+			{
+				ReadT Reader([&](ReadObjectT &Object) { Setup(Object, Expected); });
+				Reader.Parse(Document.data(), Document.size());
+				Reader.Finish();
+			}
+
+			Measure((std::string(FormatName) + " memory").c_str(), Document.size(), Expected, [&](ReadT &Reader)
+			{
+				Reader.Parse(Document.data(), Document.size());
+				Reader.Finish();
+			});
+
+			char Filename[] = "/tmp/serialbenchXXXXXX";
+			int const File = mkstemp(Filename);
+			Check(File >= 0);
+			Check(write(File, Document.data(), Document.size()) == ssize_t(Document.size()));
+			close(File);
+			Measure((std::string(FormatName) + " file").c_str(), Document.size(), Expected,
+				[&](ReadT &Reader) { Reader.ParseFile(Filename); });
+			unlink(Filename);
+		}
+	}
+	catch (ConstructionErrorT const &Error)
+	{
+		std::cerr << "Unexpected error: " << Error << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,257 @@
+#include "../serial.h"
+#include "test.h"
+
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace Serial;
+
+//================================================================================================================
+// Documents
+static KeyTableT const Keys{"name", "int", "uint", "float", "double", "bool", "list", "object", "blob", "big"};
+
+struct ContentsT
+{
+	std::string Name;
+	int64_t Int = 0;
+	uint64_t UInt = 0, Big = 0;
+	float Float = 0;
+	double Double = 0;
+	bool Bool = false;
+	std::vector<int64_t> List;
+	int64_t Nested = 0;
+	std::vector<uint8_t> Blob;
+};
+
+static std::vector<uint8_t> MakeBlob(void)
+{
+	std::vector<uint8_t> Out(100000);
+	for (size_t Index = 0; Index < Out.size(); ++Index) Out[Index] = Index * 7;
+	return Out;
+}
+
+static std::string Write(FormatT Format)
+{
+	std::string Out;
+	{
+		WriteT Writer([&](char const *Data, size_t Length) { Out.append(Data, Length); }, Format);
+		Writer.String("name", "hello \"there\"");
+		Writer.Int("int", -12345678901);
+		Writer.UInt("uint", 7);
+		Writer.Float("float", 2.5f);
+		Writer.Double("double", 0.1);
+		Writer.Bool("bool", true);
+		Writer.UInt("big", 18446744073709551615ull);
+		Writer.String("unknown", "skipped");
+		{
+			auto List = Writer.Array("list");
+			for (int Index = 0; Index < 1000; ++Index) List.Int(Index - 500);
+		}
+		{
+			auto Object = Writer.Object("object");
+			Object.Int("int", 42);
+			auto Deeper = Object.Object("object");
+			Deeper.Bool("bool", false);
+		}
+		auto Blob = MakeBlob();
+		Writer.Binary("blob", Blob.data(), Blob.size(), BinaryFormatT::Base64);
+	}
+	return Out;
+}
+
+static void Setup(ReadObjectT &Object, ContentsT &Out)
+{
+	Object.Keys(Keys);
+	Object.String("name", [&](std::string &&Value) { Out.Name = Value; });
+	Object.Int("int", [&](int64_t Value) { Out.Int = Value; });
+	Object.UInt("uint", [&](uint64_t Value) { Out.UInt = Value; });
+	Object.UInt("big", [&](uint64_t Value) { Out.Big = Value; });
+	Object.Float("float", [&](float Value) { Out.Float = Value; });
+	Object.Double("double", [&](double Value) { Out.Double = Value; });
+	Object.Bool("bool", [&](bool Value) { Out.Bool = Value; });
+	Object.Array("list", [&](ReadArrayT &List) { List.Int([&](int64_t Value) { Out.List.push_back(Value); }); });
+	Object.Object("object", [&](ReadObjectT &Nested)
+	{
+		Nested.Keys(Keys);
+		Nested.Int("int", [&](int64_t Value) { Out.Nested = Value; });
+	});
+	Object.BinaryInto("blob", [&](size_t Length) { Out.Blob.resize(Length); return Out.Blob.data(); });
+}
+
+static void CheckContents(ContentsT const &Contents)
+{
+	Check(Contents.Name == "hello \"there\"");
+	Check(Contents.Int == -12345678901);
+	Check(Contents.UInt == 7);
+	Check(Contents.Big == 18446744073709551615ull);
+	Check(Contents.Float == 2.5f);
+	Check(Contents.Double == 0.1);
+	Check(Contents.Bool);
+	Check(Contents.List.size() == 1000);
+	Check(Contents.List.front() == -500);
+	Check(Contents.List.back() == 499);
+	Check(Contents.Nested == 42);
+	Check(Contents.Blob == MakeBlob());
+}
+
+//================================================================================================================
+// Tests
+// Every chunking must give the same result, including events split between chunks
+static void TestRoundTrip(FormatT Format)
+{
+	auto const Document = Write(Format);
+	for (size_t Chunk : {size_t(1), size_t(3), size_t(7), size_t(4096), Document.size()})
+	{
+		ContentsT Contents;
+		ReadT Reader([&](ReadObjectT &Object) { Setup(Object, Contents); });
+		for (size_t Start = 0; Start < Document.size(); Start += Chunk)
+			Reader.Parse(Document.data() + Start, std::min(Chunk, Document.size() - Start));
+		Reader.Finish();
+		CheckContents(Contents);
+	}
+}
+
+static double ReadNumber(std::string const &Text, bool AsFloat)
+{
+	double Out = 0;
+	auto Document = "{\"double\": " + Text + "}";
+	ReadT Reader([&](ReadObjectT &Object)
+	{
+		Object.Keys(Keys);
+		if (AsFloat) Object.Float("double", [&](float Value) { Out = Value; });
+		else Object.Double("double", [&](double Value) { Out = Value; });
+	});
+	Reader.Parse(Document.data(), Document.size());
+	Reader.Finish();
+	return Out;
+}
+
+// Binary documents carry reals as doubles, narrowed when read as floats
+static float ReadBinaryFloat(double Value)
+{
+	std::string Document;
+	{
+		WriteT Writer([&](char const *Data, size_t Length) { Document.append(Data, Length); }, FormatT::Binary);
+		Writer.Double("float", Value);
+	}
+	float Out = 0;
+	ReadT Reader([&](ReadObjectT &Object)
+	{
+		Object.Keys(Keys);
+		Object.Float("float", [&](float Value) { Out = Value; });
+	});
+	Reader.Parse(Document.data(), Document.size());
+	Reader.Finish();
+	return Out;
+}
+
+static void TestNumbers(void)
+{
+	Check(ReadNumber("0.1", false) == 0.1);
+	Check(ReadNumber("0.1", true) == double(0.1f));
+	Check(ReadNumber("-1.7976931348623157e308", false) == -1.7976931348623157e308);
+	Check(ReadNumber("123456789.123456789", false) == 123456789.123456789);
+	Check(ReadNumber("1e-400", false) == 0);
+	CheckThrows(ConstructionErrorT, ReadNumber("1e39", true));
+	CheckThrows(ConstructionErrorT, ReadNumber("1e309", false));
+
+	// Rounded once, correctly
+	Check(ReadNumber("40e125", false) == 40e125);
+	Check(ReadNumber("52672e-206", false) == 52672e-206);
+	Check(ReadNumber("8902149740606547e-18", true) == double(8902149740606547e-18f));
+	Check(ReadNumber("8109967783093453e-17", true) == double(8109967783093453e-17f));
+
+	// Range is checked after rounding
+	Check(ReadNumber("3.4028235e38", true) == double(std::numeric_limits<float>::max()));
+	CheckThrows(ConstructionErrorT, ReadNumber("3.4028236e38", true));
+	Check(ReadNumber("1.7976931348623158e308", false) == std::numeric_limits<double>::max());
+	CheckThrows(ConstructionErrorT, ReadNumber("1.7976931348623159e308", false));
+	double const FloatMax = std::numeric_limits<float>::max();
+	Check(ReadBinaryFloat(FloatMax + std::ldexp(1.0, 102)) == std::numeric_limits<float>::max());
+	CheckThrows(ConstructionErrorT, ReadBinaryFloat(FloatMax + std::ldexp(1.0, 103)));
+}
+
+static void TestMalformed(void)
+{
+	auto const Document = Write(FormatT::Binary);
+	for (size_t Cut : {size_t(2), size_t(5), Document.size() / 2, Document.size() - 1})
+	{
+		CheckThrows(ConstructionErrorT,
+		{
+			ReadT Reader([](ReadObjectT &) {});
+			Reader.Parse(Document.data(), Cut);
+			Reader.Finish();
+		});
+	}
+	auto const Trailing = Document + "\x01";
+	CheckThrows(ConstructionErrorT,
+	{
+		ReadT Reader([](ReadObjectT &) {});
+		Reader.Parse(Trailing.data(), Trailing.size());
+		Reader.Finish();
+	});
+}
+
+// Files are mapped, pipes are read in chunks
+static void TestSources(FormatT Format)
+{
+	auto const Document = Write(Format);
+
+	char Filename[] = "/tmp/serialtestXXXXXX";
+	int const File = mkstemp(Filename);
+	Check(File >= 0);
+	Check(write(File, Document.data(), Document.size()) == ssize_t(Document.size()));
+	close(File);
+	{
+		ContentsT Contents;
+		ReadT Reader([&](ReadObjectT &Object) { Setup(Object, Contents); });
+		Reader.ParseFile(Filename);
+		CheckContents(Contents);
+	}
+	unlink(Filename);
+
+	int Pipe[2];
+	Check(pipe(Pipe) == 0);
+	if (fork() == 0)
+	{
+		close(Pipe[0]);
+		size_t Written = 0;
+		while (Written < Document.size())
+		{
+			auto Count = write(Pipe[1], Document.data() + Written, Document.size() - Written);
+			if (Count <= 0) _exit(1);
+			Written += Count;
+		}
+		_exit(0);
+	}
+	close(Pipe[1]);
+	{
+		ContentsT Contents;
+		ReadT Reader([&](ReadObjectT &Object) { Setup(Object, Contents); });
+		Reader.ParseDescriptor(Pipe[0], 1000);
+		CheckContents(Contents);
+	}
+	close(Pipe[0]);
+}
+
+int main(void)
+{
+	try
+	{
+		TestRoundTrip(FormatT::JSON);
+		TestRoundTrip(FormatT::Binary);
+		TestNumbers();
+		TestMalformed();
+		TestSources(FormatT::JSON);
+		TestSources(FormatT::Binary);
+	}
+	catch (ConstructionErrorT const &Error)
+	{
+		std::cerr << "Unexpected error: " << Error << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef test_h
+#define test_h
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Unlike Assert, stays on in release builds.  The first failure ends the test.
+#define Check(Condition) do { if (!(Condition)) { \
+	std::cerr << __FILE__ << ":" << __LINE__ << " Check failed: " #Condition << std::endl; \
+	std::exit(1); } } while (0)
+
+// Runs Body and checks that it threw ErrorT
+#define CheckThrows(ErrorT, Body) do { bool Threw = false; try { Body; } catch (ErrorT const &) { Threw = true; } \
+	Check(Threw); } while (0)
+
+// Runs Body in a child process and checks that it failed (like an ERROR) after printing Expected
+#define CheckDies(Expected, Body) do { std::cout.flush(); int Pipe[2]; Check(pipe(Pipe) == 0); auto const Child = fork(); \
+	Check(Child >= 0); \
+	if (Child == 0) { dup2(Pipe[1], 1); dup2(Pipe[1], 2); close(Pipe[0]); { Body; } std::cout.flush(); _exit(0); } \
+	close(Pipe[1]); std::string Output; char Buffer[256]; ssize_t Length; \
+	while ((Length = read(Pipe[0], Buffer, sizeof(Buffer))) > 0) Output.append(Buffer, Length); \
+	close(Pipe[0]); int Status = 0; Check(waitpid(Child, &Status, 0) == Child); \
+	Check(!WIFEXITED(Status) || (WEXITSTATUS(Status) != 0)); \
+	Check(Output.find(Expected) != std::string::npos); } while (0)
+
+#endif
@@ -347,11 +347,11 @@ template <typename... TypesT> struct VariantT : private VariantInternalsT<TypesT
 			
 		VariantT(VariantT<TypesT...> const &Value) : Internals(Union, ValueUnion, Value) {}
 		
-		VariantT(VariantT<TypesT...> &&Value) : Internals(Union, std::move(ValueUnion), Value) {}
+		VariantT(VariantT<TypesT...> &&Value) noexcept : Internals(Union, std::move(ValueUnion), Value) {}
 		
 		~VariantT(void) { this->Destroy(Union); }
 		
-		void Clear(void) { Destroy(Union); this->Tag = nullptr; }
+		void Clear(void) { this->Destroy(Union); this->Tag = nullptr; }
 		
 		operator bool(void) const { return this->Tag; }
 		